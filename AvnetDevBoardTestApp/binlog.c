@@ -0,0 +1,97 @@
+#include <time.h>
+
+#include <applibs/log.h>
+
+#include "binlog.h"
+
+#ifndef BINLOG_RAW
+static const char *const formats[] = {
+#define BINLOG_FORMAT_STRING(id, format) format,
+    BINLOG_FORMATS(BINLOG_FORMAT_STRING)
+#undef BINLOG_FORMAT_STRING
+};
+#endif
+
+// Ring of records.  head counts every record written and tail every record flushed, so head - tail is
+// the number pending; more than BINLOG_RING_SIZE means the oldest were overwritten.
+static BinLog_Record ring[BINLOG_RING_SIZE];
+static uint32_t head = 0;
+static uint32_t tail = 0;
+
+void BinLog_Write(BinLog_FormatId format, int argCount, int32_t a0, int32_t a1, int32_t a2, int32_t a3,
+                  int32_t a4, int32_t a5)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    BinLog_Record *record = &ring[head & (BINLOG_RING_SIZE - 1)];
+    record->timeUs = (uint32_t)now.tv_sec * 1000000u + (uint32_t)(now.tv_nsec / 1000);
+    record->format = (uint16_t)format;
+    record->argCount = (uint8_t)argCount;
+    record->reserved = 0;
+    record->args[0] = a0;
+    record->args[1] = a1;
+    record->args[2] = a2;
+    record->args[3] = a3;
+    record->args[4] = a4;
+    record->args[5] = a5;
+    head++;
+}
+
+#ifdef BINLOG_RAW
+/// <summary>
+///     Logs a record as one line of hex in its in-memory layout, for HostTools/binlog_decode.
+/// </summary>
+static void LogRecordHex(const BinLog_Record *record)
+{
+    static const char digits[] = "0123456789abcdef";
+    uint8_t bytes[sizeof(BinLog_Record)];
+    char line[2 * sizeof(BinLog_Record) + 1];
+
+    // Stored little-endian field by field, so the dump does not depend on the host byte order
+    size_t length = 0;
+    for (int i = 0; i < 4; i++) {
+        bytes[length++] = (uint8_t)(record->timeUs >> (8 * i));
+    }
+    bytes[length++] = (uint8_t)record->format;
+    bytes[length++] = (uint8_t)(record->format >> 8);
+    bytes[length++] = record->argCount;
+    bytes[length++] = record->reserved;
+    for (int a = 0; a < BINLOG_MAX_ARGS; a++) {
+        for (int i = 0; i < 4; i++) {
+            bytes[length++] = (uint8_t)((uint32_t)record->args[a] >> (8 * i));
+        }
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        line[2 * i] = digits[bytes[i] >> 4];
+        line[2 * i + 1] = digits[bytes[i] & 0xf];
+    }
+    line[2 * length] = '\0';
+    Log_Debug("BINLOG: %s\n", line);
+}
+#endif
+
+void BinLog_Flush(void)
+{
+    if (head - tail > BINLOG_RING_SIZE) {
+        Log_Debug("INFO: Binary log overflowed, %u records were dropped.\n",
+                  head - tail - BINLOG_RING_SIZE);
+        tail = head - BINLOG_RING_SIZE;
+    }
+
+    while (tail != head) {
+        const BinLog_Record *record = &ring[tail & (BINLOG_RING_SIZE - 1)];
+        tail++;
+
+#ifdef BINLOG_RAW
+        LogRecordHex(record);
+#else
+        // Every format takes int arguments only; unused trailing arguments are ignored
+        if (record->format < BinLog_FormatCount) {
+            Log_Debug(formats[record->format], record->args[0], record->args[1], record->args[2],
+                      record->args[3], record->args[4], record->args[5]);
+        }
+#endif
+    }
+}
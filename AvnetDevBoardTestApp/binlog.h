@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "binlog_formats.h"
+#include "platform.h"
+
+/// <summary>
+///     Binary log.  BINLOG records a format ID and its integer arguments in a ring in RAM, without
+///     formatting anything, so logging from a measurement loop does not skew it.  BinLog_Flush
+///     formats the records through Log_Debug later, when the event loop is idle, or with BINLOG_RAW
+///     defined in platform.h logs them as hex for HostTools/binlog_decode.  BINLOG_DEBUG records only
+///     when SHOW_DEBUG is defined; otherwise it compiles to nothing and its arguments are not
+///     evaluated.
+/// </summary>
+
+/// <summary>
+///     Maximum number of arguments of a record.
+/// </summary>
+#define BINLOG_MAX_ARGS 6
+
+/// <summary>
+///     Number of records the ring holds; a power of two.  When it is full the oldest are overwritten.
+/// </summary>
+#define BINLOG_RING_SIZE 256
+
+/// <summary>
+///     Format IDs, BinLog_ followed by the name in binlog_formats.h.
+/// </summary>
+typedef enum {
+#define BINLOG_FORMAT_ID(id, format) BinLog_##id,
+    BINLOG_FORMATS(BINLOG_FORMAT_ID)
+#undef BINLOG_FORMAT_ID
+        BinLog_FormatCount
+} BinLog_FormatId;
+
+/// <summary>
+///     One record, 32 bytes.  BINLOG_RAW dumps it little-endian in this layout.
+/// </summary>
+typedef struct {
+    uint32_t timeUs;
+    uint16_t format;
+    uint8_t argCount;
+    uint8_t reserved;
+    int32_t args[BINLOG_MAX_ARGS];
+} BinLog_Record;
+
+#define BINLOG_ARG_COUNT(...) BINLOG_ARG_COUNT_(__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define BINLOG_ARG_COUNT_(a, b, c, d, e, f, count, ...) count
+#define BINLOG_ARGS(...) BINLOG_ARGS_(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#define BINLOG_ARGS_(a, b, c, d, e, f, ...)                                                       \
+    (int32_t)(a), (int32_t)(b), (int32_t)(c), (int32_t)(d), (int32_t)(e), (int32_t)(f)
+
+/// <summary>
+///     Records a log entry: the format name from binlog_formats.h and 1 to BINLOG_MAX_ARGS integers.
+/// </summary>
+#define BINLOG(id, ...)                                                                           \
+    BinLog_Write(BinLog_##id, BINLOG_ARG_COUNT(__VA_ARGS__), BINLOG_ARGS(__VA_ARGS__))
+
+#ifdef SHOW_DEBUG
+#define BINLOG_DEBUG(id, ...) BINLOG(id, __VA_ARGS__)
+#else
+#define BINLOG_DEBUG(id, ...) ((void)0)
+#endif
+
+/// <summary>
+///     Appends a record to the ring.  Use BINLOG rather than calling it directly.
+/// </summary>
+void BinLog_Write(BinLog_FormatId format, int argCount, int32_t a0, int32_t a1, int32_t a2, int32_t a3,
+                  int32_t a4, int32_t a5);
+
+/// <summary>
+///     Logs the records written since the last flush, oldest first, and reports any that were
+///     overwritten before they could be logged.
+/// </summary>
+void BinLog_Flush(void);
@@ -0,0 +1,11 @@
+#pragma once
+
+// Formats of the binary log.  Each entry is an ID and a Log_Debug format whose conversions all take an int
+// (%d, %u, %x, %c), with at most BINLOG_MAX_ARGS of them.  The records store the ID, so entries are only ever
+// added at the end; HostTools/binlog_decode.c includes this file to decode dumps from the same build.
+#define BINLOG_FORMATS(X)                                                                                              \
+    X(GPIO_BATCH_MISMATCH, "TEST FAILURE: %d of %d pairs read the wrong level at step %d\n")                          \
+    X(GPIO_READ_MISMATCH, "TEST FAILURE: Validation Failed!  Read %d from GPIO_%d, expected %d\n")                    \
+    X(GPIO_TESTING_BATCH, "TEST INFO: Testing a batch of %d GPIO pairs\n")                                            \
+    X(GPIO_TESTING_PAIR, "TEST INFO: Testing GPIO_%d --> GPIO_%d\n")                                                  \
+    X(GPIO_LATENCY_MISSED, "GPIO LATENCY: GPIO_%d --> GPIO_%d missed %d of %d edges within %d us\n")
@@ -0,0 +1,159 @@
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <applibs/log.h>
+
+#include "applibs_versions.h"
+#include "epoll_timerfd_utilities.h"
+#include "blink_code.h"
+#include "platform.h"
+
+// Termination state
+extern sig_atomic_t terminationRequired;
+
+static const RgbLed *blinkLed = NULL;
+static BlinkCode_Step pattern[BLINK_CODE_MAX_STEPS];
+static size_t patternLength = 0;
+static size_t currentStep = 0;
+
+/// <summary>
+///     Shows the current step and returns its duration.
+/// </summary>
+static struct timespec ShowStep(void)
+{
+    const BlinkCode_Step *step = &pattern[currentStep];
+    struct timespec duration = {.tv_sec = step->durationMs / 1000,
+                                .tv_nsec = (long)(step->durationMs % 1000) * 1000000};
+
+    RgbLedUtility_SetLed(blinkLed, step->color);
+    return duration;
+}
+
+/// <summary>
+///     Moves to the next step when the current one has run its time.
+/// </summary>
+static void BlinkTimerHandler(wheel_timer_t *timer)
+{
+    if (patternLength == 0) {
+        return;
+    }
+
+    // Each step ends a fixed time after the last one ended, so the code keeps its rhythm
+    currentStep = (currentStep + 1) % patternLength;
+    struct timespec duration = ShowStep();
+    if (AdvanceWheelTimer(timer, &duration) != 0) {
+        terminationRequired = true;
+    }
+}
+
+static wheel_timer_t blinkTimer = {.handler = &BlinkTimerHandler};
+
+/// <summary>
+///     Appends a step to a pattern being built, extending the last step if it has the same color.
+///     BLINK_CODE_MAX_STEPS is sized for the longest failure code, so the pattern never fills.
+/// </summary>
+static void AddStep(BlinkCode_Step *steps, size_t *stepCount, RgbLedUtility_Colors color,
+                    uint32_t units)
+{
+    if (*stepCount > 0 && steps[*stepCount - 1].color == color) {
+        steps[*stepCount - 1].durationMs += units * BLINK_CODE_UNIT_MS;
+    } else if (*stepCount < BLINK_CODE_MAX_STEPS) {
+        steps[*stepCount].color = color;
+        steps[*stepCount].durationMs = units * BLINK_CODE_UNIT_MS;
+        (*stepCount)++;
+    }
+}
+
+int BlinkCode_Play(const RgbLed *led, const BlinkCode_Step *steps, size_t stepCount)
+{
+    if (stepCount == 0 || stepCount > BLINK_CODE_MAX_STEPS) {
+        Log_Debug("ERROR: A blink pattern needs 1 to %d steps.\n", BLINK_CODE_MAX_STEPS);
+        return -1;
+    }
+
+    if (blinkLed != NULL && blinkLed != led) {
+        RgbLedUtility_SetLed(blinkLed, RgbLedUtility_Colors_Off);
+    }
+
+    patternLength = 0;
+    for (size_t i = 0; i < stepCount; i++) {
+        if (patternLength > 0 && pattern[patternLength - 1].color == steps[i].color) {
+            pattern[patternLength - 1].durationMs += steps[i].durationMs;
+        } else {
+            pattern[patternLength++] = steps[i];
+        }
+    }
+
+    blinkLed = led;
+    currentStep = 0;
+    struct timespec duration = ShowStep();
+    return StartWheelTimer(&blinkTimer, &duration, NULL);
+}
+
+int BlinkCode_ShowFailure(const RgbLed *led, TestCategory category, int index)
+{
+    static const RgbLedUtility_Colors categoryColors[] = {
+        [TestCategory_Other] = RgbLedUtility_Colors_White,
+        [TestCategory_Gpio] = RgbLedUtility_Colors_Magenta,
+        [TestCategory_Uart] = RgbLedUtility_Colors_Cyan,
+        [TestCategory_Wifi] = RgbLedUtility_Colors_Blue,
+        [TestCategory_Led] = RgbLedUtility_Colors_Yellow};
+
+    BlinkCode_Step steps[BLINK_CODE_MAX_STEPS];
+    size_t stepCount = 0;
+
+    RgbLedUtility_Colors color = RgbLedUtility_Colors_White;
+    if ((size_t)category < sizeof(categoryColors) / sizeof(*categoryColors)) {
+        color = categoryColors[category];
+    }
+    AddStep(steps, &stepCount, color, 4);
+    AddStep(steps, &stepCount, RgbLedUtility_Colors_Off, 2);
+
+    if (index >= 0) {
+        // Digits are sent most significant first
+        char digits[12];
+        int digitCount = snprintf(digits, sizeof(digits), "%d", index);
+        for (int d = 0; d < digitCount; d++) {
+            int blinks = digits[d] - '0';
+            if (blinks == 0) {
+                AddStep(steps, &stepCount, RgbLedUtility_Colors_Red, 4);
+                AddStep(steps, &stepCount, RgbLedUtility_Colors_Off, 1);
+            }
+            for (int b = 0; b < blinks; b++) {
+                AddStep(steps, &stepCount, RgbLedUtility_Colors_Red, 1);
+                AddStep(steps, &stepCount, RgbLedUtility_Colors_Off, 1);
+            }
+            AddStep(steps, &stepCount, RgbLedUtility_Colors_Off, 2);
+        }
+    }
+    AddStep(steps, &stepCount, RgbLedUtility_Colors_Off, 6);
+
+    Log_Debug("INFO: Blink code: %s for the failed category, then index %d in red.\n",
+              RgbLedUtility_GetStringFromColor(color), index);
+
+    return BlinkCode_Play(led, steps, stepCount);
+}
+
+void BlinkCode_Stop(void)
+{
+    if (blinkLed == NULL) {
+        return;
+    }
+
+    StopWheelTimer(&blinkTimer);
+    RgbLedUtility_SetLed(blinkLed, RgbLedUtility_Colors_Off);
+    blinkLed = NULL;
+    patternLength = 0;
+}
+
+bool BlinkCode_Playing(void)
+{
+    return blinkLed != NULL;
+}
+
+void BlinkCode_Close(void)
+{
+    BlinkCode_Stop();
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rgbled_utility.h"
+#include "test_registry.h"
+
+/// <summary>
+///     Maximum number of steps in one pattern. BlinkCode_ShowFailure needs two steps for the
+///     category and the pause after it, then at most 18 for each digit of the index (nine blinks
+///     and the gaps between them), and a non-negative int has up to 10 digits.
+/// </summary>
+#define BLINK_CODE_MAX_STEPS (2 + 18 * 10)
+
+/// <summary>
+///     One step of a pattern: the LED shows the color for the duration.
+/// </summary>
+typedef struct {
+    RgbLedUtility_Colors color;
+    uint32_t durationMs;
+} BlinkCode_Step;
+
+/// <summary>
+///     Plays a pattern on an LED, repeating it until BlinkCode_Stop is called or another pattern is
+///     played. The steps are copied, and consecutive steps of the same color are merged.
+/// </summary>
+/// <param name="led">The LED to drive</param>
+/// <param name="steps">The steps of the pattern</param>
+/// <param name="stepCount">Number of steps, at most BLINK_CODE_MAX_STEPS</param>
+/// <returns>0 on success, or -1 if the pattern is empty, too long or the timer could not be set</returns>
+int BlinkCode_Play(const RgbLed *led, const BlinkCode_Step *steps, size_t stepCount);
+
+/// <summary>
+///     Plays the blink code of a failed test: the category color (GPIO magenta, UART cyan, WiFi
+///     blue, LED yellow, other white) for 4 units, then the decimal digits of the failure index as
+///     red blinks of one unit each, with a single long red blink for a 0 digit. An index below zero
+///     shows the category alone. The code repeats after a pause. A unit is BLINK_CODE_UNIT_MS.
+/// </summary>
+/// <param name="led">The LED to drive</param>
+/// <param name="category">Category of the failed test</param>
+/// <param name="index">The item that failed, e.g. the GPIO pair or ISU number, or -1</param>
+/// <returns>0 on success, or -1 if the timer could not be set</returns>
+int BlinkCode_ShowFailure(const RgbLed *led, TestCategory category, int index);
+
+/// <summary>
+///     Stops the pattern and turns its LED off.
+/// </summary>
+void BlinkCode_Stop(void);
+
+/// <summary>
+///     Returns true while a pattern is playing.
+/// </summary>
+bool BlinkCode_Playing(void);
+
+/// <summary>
+///     Stops the pattern and turns its LED off.
+/// </summary>
+void BlinkCode_Close(void);
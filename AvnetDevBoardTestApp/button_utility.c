@@ -0,0 +1,228 @@
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <applibs/gpio.h>
+#include <applibs/log.h>
+
+#include "applibs_versions.h"
+#include "epoll_timerfd_utilities.h"
+#include "button_utility.h"
+#include "platform.h"
+
+// Termination state
+extern sig_atomic_t terminationRequired;
+
+/// <summary>
+///     Per-button sampling and debounce state.
+/// </summary>
+typedef struct {
+    int fd;
+    GPIO_Id gpio;
+    GPIO_Value_Type rawState;
+    GPIO_Value_Type stableState;
+    uint64_t rawChangeNs;
+    uint64_t edgeNs;
+} Button;
+
+static Button buttons[MAX_BUTTON_COUNT];
+static size_t buttonCount = 0;
+static ButtonUtility_PressHandler pressHandler = NULL;
+
+static int buttonTimerFd = -1;
+static bool bursting = false;
+static uint64_t burstEndNs = 0;
+static uint64_t lastSampleNs = 0;
+
+static ButtonUtility_Stats stats;
+static uint64_t statsStartNs = 0;
+
+static const struct timespec idlePeriod = {BUTTON_IDLE_POLL_MS / 1000,
+                                           (BUTTON_IDLE_POLL_MS % 1000) * 1000000};
+static const struct timespec burstPeriod = {BUTTON_BURST_POLL_MS / 1000,
+                                            (BUTTON_BURST_POLL_MS % 1000) * 1000000};
+
+static uint64_t NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/// <summary>
+///     Samples one button and returns true when a debounced press has just been detected.
+///     previousSampleNs is when the buttons were last sampled, the earliest an edge seen now can
+///     have happened.
+/// </summary>
+static bool SampleButton(Button *button, uint64_t nowNs, uint64_t previousSampleNs, bool *outEdgeSeen)
+{
+    GPIO_Value_Type newState;
+    stats.gpioReads++;
+    if (GPIO_GetValue(button->fd, &newState) != 0) {
+        Log_Debug("ERROR: Could not read button GPIO: %s (%d).\n", strerror(errno), errno);
+        terminationRequired = true;
+        return false;
+    }
+
+    if (newState != button->rawState) {
+        // Remember the first edge of a bounce sequence for the press latency. It is timed from the
+        // previous sample, so the latency includes the up to one poll period the edge went unseen.
+        if (button->rawState == button->stableState) {
+            button->edgeNs = previousSampleNs;
+        }
+        button->rawState = newState;
+        button->rawChangeNs = nowNs;
+        *outEdgeSeen = true;
+    }
+
+    if (button->rawState == button->stableState ||
+        nowNs - button->rawChangeNs < (uint64_t)BUTTON_DEBOUNCE_MS * 1000000u) {
+        return false;
+    }
+
+    button->stableState = button->rawState;
+    return button->stableState == GPIO_Value_Low;
+}
+
+/// <summary>
+///     Handle button timer event: sample the buttons, switch between the idle and burst rates
+///     and report debounced presses.
+/// </summary>
+static void ButtonTimerEventHandler(event_data_t *eventData)
+{
+    if (ConsumeTimerFdEvent(buttonTimerFd) != 0) {
+        terminationRequired = true;
+        return;
+    }
+
+    stats.wakeups++;
+    uint64_t nowNs = NowNs();
+    uint64_t previousSampleNs = lastSampleNs;
+    lastSampleNs = nowNs;
+    bool edgeSeen = false;
+
+    for (size_t i = 0; i < buttonCount; i++) {
+        if (SampleButton(&buttons[i], nowNs, previousSampleNs, &edgeSeen)) {
+            uint32_t latencyUs = (uint32_t)((NowNs() - buttons[i].edgeNs) / 1000u);
+            stats.presses++;
+            stats.lastPressLatencyUs = latencyUs;
+            if (latencyUs > stats.maxPressLatencyUs) {
+                stats.maxPressLatencyUs = latencyUs;
+            }
+            if (pressHandler != NULL) {
+                pressHandler(i);
+            }
+        }
+        // An unsettled level keeps the fast rate alive until it is debounced.
+        if (buttons[i].rawState != buttons[i].stableState) {
+            edgeSeen = true;
+        }
+    }
+
+    if (edgeSeen) {
+        burstEndNs = nowNs + (uint64_t)BUTTON_BURST_DURATION_MS * 1000000u;
+        if (!bursting) {
+            bursting = true;
+            if (SetTimerFdToPeriod(buttonTimerFd, &burstPeriod) != 0) {
+                terminationRequired = true;
+            }
+        }
+    } else if (bursting && nowNs >= burstEndNs) {
+        bursting = false;
+        if (SetTimerFdToPeriod(buttonTimerFd, &idlePeriod) != 0) {
+            terminationRequired = true;
+        }
+    }
+}
+
+// event handler data structures. Only the event handler field needs to be populated.
+static event_data_t buttonEventData = {.eventHandler = &ButtonTimerEventHandler};
+
+int ButtonUtility_Init(int epollFd, const GPIO_Id *buttonGpios, size_t count,
+                       ButtonUtility_PressHandler handler)
+{
+    if (count > MAX_BUTTON_COUNT) {
+        Log_Debug("ERROR: Cannot specify more than %d buttons.\n", MAX_BUTTON_COUNT);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Log_Debug("INFO: Opening button %zu (GPIO_%d).\n", i, buttonGpios[i]);
+        buttons[i].gpio = buttonGpios[i];
+        buttons[i].fd = GPIO_OpenAsInput(buttonGpios[i]);
+        if (buttons[i].fd < 0) {
+            Log_Debug("ERROR: Could not open GPIO '%d': %d (%s).\n", buttonGpios[i], errno,
+                      strerror(errno));
+            return -1;
+        }
+        buttons[i].rawState = GPIO_Value_High;
+        buttons[i].stableState = GPIO_Value_High;
+        buttonCount = i + 1;
+    }
+
+    pressHandler = handler;
+    bursting = false;
+    memset(&stats, 0, sizeof(stats));
+    statsStartNs = NowNs();
+    lastSampleNs = statsStartNs;
+
+    buttonTimerFd =
+        CreateTimerFdAndAddToEpoll(epollFd, &idlePeriod, &buttonEventData, EPOLLIN);
+    if (buttonTimerFd < 0) {
+        return -1;
+    }
+    SetEventTelemetryName(&buttonEventData, "ButtonTimer");
+
+    return 0;
+}
+
+void ButtonUtility_Close(void)
+{
+    CloseFdAndPrintError(buttonTimerFd, "ButtonTimer");
+    buttonTimerFd = -1;
+
+    for (size_t i = 0; i < buttonCount; i++) {
+        CloseFdAndPrintError(buttons[i].fd, "Button");
+        buttons[i].fd = -1;
+    }
+    buttonCount = 0;
+}
+
+int ButtonUtility_GetFd(GPIO_Id gpio)
+{
+    for (size_t i = 0; i < buttonCount; i++) {
+        if (buttons[i].gpio == gpio) {
+            return buttons[i].fd;
+        }
+    }
+    return -1;
+}
+
+void ButtonUtility_GetStats(ButtonUtility_Stats *outStats)
+{
+    *outStats = stats;
+    outStats->elapsedMs = (uint32_t)((NowNs() - statsStartNs) / 1000000u);
+}
+
+void ButtonUtility_LogStats(void)
+{
+    ButtonUtility_Stats current;
+    ButtonUtility_GetStats(&current);
+
+    float seconds = (float)current.elapsedMs / 1000.0f;
+    if (current.wakeups > 0 && seconds > 0.0f) {
+        Log_Debug("INFO: Buttons: %.1f wakeups/s and %.1f GPIO reads/s over %.1fs (a fixed 1 ms "
+                  "poll costs 1000 wakeups/s and %d reads/s).\n",
+                  (float)current.wakeups / seconds, (float)current.gpioReads / seconds, seconds,
+                  1000 * (int)buttonCount);
+    }
+    if (current.presses > 0) {
+        Log_Debug("INFO: Buttons: %u presses, press-to-action latency last %u us, max %u us.\n",
+                  current.presses, current.lastPressLatencyUs, current.maxPressLatencyUs);
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    statsStartNs = NowNs();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <applibs/gpio.h>
+
+/// <summary>
+///     Maximum number of buttons the utility can monitor.
+/// </summary>
+#define MAX_BUTTON_COUNT 2
+
+/// <summary>
+///     Function signature for the handler called once per debounced button press.
+/// </summary>
+/// <param name="buttonIndex">Index of the button in the array passed to ButtonUtility_Init</param>
+typedef void (*ButtonUtility_PressHandler)(size_t buttonIndex);
+
+/// <summary>
+///     Counters describing the cost and responsiveness of button monitoring.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     Timer wakeups since the counters were last reset
+    /// </summary>
+    uint32_t wakeups;
+    /// <summary>
+    ///     GPIO reads since the counters were last reset
+    /// </summary>
+    uint32_t gpioReads;
+    /// <summary>
+    ///     Debounced presses since the counters were last reset
+    /// </summary>
+    uint32_t presses;
+    /// <summary>
+    ///     Time from the sample before the first edge was seen to the press handler for the last
+    ///     press, so it includes the time the edge waited for the next poll
+    /// </summary>
+    uint32_t lastPressLatencyUs;
+    /// <summary>
+    ///     Largest press-to-action latency since the counters were last reset
+    /// </summary>
+    uint32_t maxPressLatencyUs;
+    /// <summary>
+    ///     Length of the measurement window in milliseconds
+    /// </summary>
+    uint32_t elapsedMs;
+} ButtonUtility_Stats;
+
+/// <summary>
+///     Opens the given button GPIOs as inputs and starts monitoring them on the epoll instance.
+///     The buttons are sampled every BUTTON_IDLE_POLL_MS while idle and every
+///     BUTTON_BURST_POLL_MS for BUTTON_BURST_DURATION_MS after any edge; a level only counts once
+///     it has been stable for BUTTON_DEBOUNCE_MS.
+/// </summary>
+/// <param name="epollFd">Epoll file descriptor</param>
+/// <param name="buttonGpios">The button GPIOs; a pressed button reads low</param>
+/// <param name="buttonCount">Number of buttons, at most MAX_BUTTON_COUNT</param>
+/// <param name="pressHandler">Called once for every debounced press</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int ButtonUtility_Init(int epollFd, const GPIO_Id *buttonGpios, size_t buttonCount,
+                       ButtonUtility_PressHandler pressHandler);
+
+/// <summary>
+///     Stops monitoring and closes the button file descriptors.
+/// </summary>
+void ButtonUtility_Close(void);
+
+/// <summary>
+///     Returns the input fd the utility holds for a button GPIO, so other code can read the button
+///     without opening it a second time.
+/// </summary>
+/// <returns>The fd, or -1 if the GPIO is not a monitored button.</returns>
+int ButtonUtility_GetFd(GPIO_Id gpio);
+
+/// <summary>
+///     Copies the counters gathered since the last reset.
+/// </summary>
+/// <param name="outStats">Receives the counters</param>
+void ButtonUtility_GetStats(ButtonUtility_Stats *outStats);
+
+/// <summary>
+///     Logs wakeups per second, GPIO reads and press latency against the cost of a fixed 1 ms
+///     poll, then resets the counters.
+/// </summary>
+void ButtonUtility_LogStats(void);
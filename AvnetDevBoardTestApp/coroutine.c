@@ -0,0 +1,145 @@
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <applibs/log.h>
+
+#include "coroutine.h"
+
+// Termination state
+extern sig_atomic_t terminationRequired;
+
+#define COROUTINE_FROM_MEMBER(pointer, member)                                                    \
+    ((coroutine_t *)((char *)(pointer)-offsetof(coroutine_t, member)))
+
+/// <summary>
+///     Stops the timer and takes the awaited fd off the epoll instance.
+/// </summary>
+static void StopWaiting(coroutine_t *co)
+{
+    StopWheelTimer(&co->timer);
+    if (co->waitFd >= 0) {
+        UnregisterEventHandlerFromEpoll(co->epollFd, co->waitFd);
+        co->waitFd = -1;
+    }
+}
+
+/// <summary>
+///     Runs the body from its last resume point.
+/// </summary>
+static void Resume(coroutine_t *co)
+{
+    if (co->body(co) == COROUTINE_DONE) {
+        co->running = false;
+        StopWaiting(co);
+        if (co->doneHandler != NULL) {
+            co->doneHandler(co);
+        }
+    }
+}
+
+/// <summary>
+///     Handle coroutine timer expiry: a delay has passed, or a wait for an fd has timed out.
+/// </summary>
+static void CoroutineTimerHandler(wheel_timer_t *timer)
+{
+    coroutine_t *co = COROUTINE_FROM_MEMBER(timer, timer);
+
+    if (!co->running) {
+        return;
+    }
+
+    co->timedOut = co->waitFd >= 0;
+    StopWaiting(co);
+    Resume(co);
+}
+
+/// <summary>
+///     Handle awaited fd event: the fd is ready.
+/// </summary>
+static void CoroutineFdEventHandler(event_data_t *eventData)
+{
+    coroutine_t *co = COROUTINE_FROM_MEMBER(eventData, fdEventData);
+
+    if (!co->running || co->waitFd < 0) {
+        return;
+    }
+
+    co->timedOut = false;
+    StopWaiting(co);
+    Resume(co);
+}
+
+int Coroutine_Start(coroutine_t *co, int epollFd, coroutine_body_t body,
+                    coroutine_done_handler_t doneHandler, void *context)
+{
+    // The fd handler doubles as the marker that the coroutine has been set up
+    if (co->fdEventData.eventHandler == NULL) {
+        co->timer.handler = &CoroutineTimerHandler;
+        co->fdEventData.eventHandler = &CoroutineFdEventHandler;
+        co->epollFd = epollFd;
+        co->waitFd = -1;
+        SetEventTelemetryName(&co->fdEventData, "CoroutineFd");
+    }
+
+    Coroutine_Cancel(co);
+    co->body = body;
+    co->doneHandler = doneHandler;
+    co->context = context;
+    co->running = true;
+    Resume(co);
+    return 0;
+}
+
+void Coroutine_SleepFor(coroutine_t *co, const struct timespec *delay)
+{
+    if (StartWheelTimer(&co->timer, delay, NULL) != 0) {
+        terminationRequired = true;
+    }
+}
+
+void Coroutine_SleepUntil(coroutine_t *co, const struct timespec *deadline)
+{
+    if (StartWheelTimerAt(&co->timer, deadline, NULL) != 0) {
+        terminationRequired = true;
+    }
+}
+
+void Coroutine_WaitFd(coroutine_t *co, int fd, uint32_t events, const struct timespec *timeout)
+{
+    if (RegisterEventHandlerToEpoll(co->epollFd, fd, &co->fdEventData, events) != 0) {
+        terminationRequired = true;
+        return;
+    }
+    co->waitFd = fd;
+
+    if (timeout != NULL) {
+        Coroutine_SleepFor(co, timeout);
+    }
+}
+
+bool Coroutine_TimedOut(const coroutine_t *co)
+{
+    return co->timedOut;
+}
+
+bool Coroutine_Running(const coroutine_t *co)
+{
+    return co->running;
+}
+
+void Coroutine_Cancel(coroutine_t *co)
+{
+    if (co->fdEventData.eventHandler != NULL) {
+        StopWaiting(co);
+    }
+    co->running = false;
+    co->timedOut = false;
+    co->resumePoint = 0;
+}
+
+void Coroutine_Close(coroutine_t *co)
+{
+    Coroutine_Cancel(co);
+    co->fdEventData.eventHandler = NULL;
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "epoll_timerfd_utilities.h"
+
+/// <summary>
+///     Stackless coroutines on the epoll loop, in the style of protothreads. A coroutine is a
+///     function that runs from CO_BEGIN to CO_END and suspends at the CO_AWAIT_* points; the event
+///     loop resumes it when the timer or fd it waits for is ready. Only the resume point is kept
+///     across a suspension, so values that must survive an await go in statics or in the context,
+///     never in locals, and a switch statement cannot span an await. Each await must be on its own
+///     source line.
+/// </summary>
+
+/// <summary>
+///     Values returned by a coroutine body.
+/// </summary>
+#define COROUTINE_WAITING 0
+#define COROUTINE_DONE 1
+
+typedef struct coroutine coroutine_t;
+
+/// <summary>
+///     Function signature for coroutine bodies.
+/// </summary>
+/// <param name="co">The coroutine being run</param>
+/// <returns>COROUTINE_WAITING when suspended, COROUTINE_DONE when finished</returns>
+typedef int (*coroutine_body_t)(coroutine_t *co);
+
+/// <summary>
+///     Function signature for the handler called once a coroutine has finished.
+/// </summary>
+/// <param name="co">The coroutine that finished; it may be started again from the handler</param>
+typedef void (*coroutine_done_handler_t)(coroutine_t *co);
+
+/// <summary>
+///     A coroutine. It must stay in memory while it runs; the fields belong to the coroutine
+///     functions, apart from context.
+/// </summary>
+struct coroutine {
+    /// <summary>
+    ///     Resumes the coroutine when a delay or timeout ends; it runs on the timer wheel
+    /// </summary>
+    wheel_timer_t timer;
+    /// <summary>
+    ///     Resumes the coroutine when the fd it waits for is ready
+    /// </summary>
+    event_data_t fdEventData;
+    coroutine_body_t body;
+    coroutine_done_handler_t doneHandler;
+    int epollFd;
+    int waitFd;
+    int resumePoint;
+    bool running;
+    bool timedOut;
+    /// <summary>
+    ///     Free for the body's own state
+    /// </summary>
+    void *context;
+};
+
+/// <summary>
+///     Opens a coroutine's body. Execution continues from the last await when resumed.
+/// </summary>
+#define CO_BEGIN(co)                                                                              \
+    switch ((co)->resumePoint) {                                                                  \
+    case 0:
+
+/// <summary>
+///     Closes a coroutine's body; reaching it finishes the coroutine.
+/// </summary>
+#define CO_END(co)                                                                                \
+    }                                                                                             \
+    (co)->resumePoint = 0;                                                                        \
+    return COROUTINE_DONE
+
+/// <summary>
+///     Finishes the coroutine early.
+/// </summary>
+#define CO_EXIT(co)                                                                               \
+    do {                                                                                          \
+        (co)->resumePoint = 0;                                                                    \
+        return COROUTINE_DONE;                                                                    \
+    } while (0)
+
+/// <summary>
+///     Suspends the coroutine here; it resumes on the next line when woken.
+/// </summary>
+#define CO_SUSPEND(co)                                                                            \
+    (co)->resumePoint = __LINE__;                                                                 \
+    return COROUTINE_WAITING;                                                                     \
+    case __LINE__:
+
+/// <summary>
+///     Waits for a delay. The time is measured from when the await is reached.
+/// </summary>
+#define CO_AWAIT_DELAY(co, delay)                                                                 \
+    do {                                                                                          \
+        Coroutine_SleepFor((co), (delay));                                                        \
+        CO_SUSPEND(co);                                                                           \
+    } while (0)
+
+/// <summary>
+///     Waits until an absolute CLOCK_MONOTONIC deadline.
+/// </summary>
+#define CO_AWAIT_DEADLINE(co, deadline)                                                           \
+    do {                                                                                          \
+        Coroutine_SleepUntil((co), (deadline));                                                   \
+        CO_SUSPEND(co);                                                                           \
+    } while (0)
+
+/// <summary>
+///     Waits until an fd is ready for the epoll events, or until the timeout has passed if it is
+///     not NULL. Coroutine_TimedOut tells which happened.
+/// </summary>
+#define CO_AWAIT_FD(co, fd, events, timeout)                                                      \
+    do {                                                                                          \
+        Coroutine_WaitFd((co), (fd), (events), (timeout));                                        \
+        CO_SUSPEND(co);                                                                           \
+    } while (0)
+
+/// <summary>
+///     Starts a coroutine on the epoll instance and runs its body up to the first await. A
+///     coroutine stays on the epoll instance it was first started on, and its delays and timeouts
+///     run on the timer wheel, which must have been created. A running coroutine is restarted.
+/// </summary>
+/// <param name="co">The coroutine</param>
+/// <param name="epollFd">Epoll file descriptor</param>
+/// <param name="body">The coroutine body</param>
+/// <param name="doneHandler">Called when the body finishes, or NULL</param>
+/// <param name="context">Stored in co->context for the body</param>
+/// <returns>0 on success</returns>
+int Coroutine_Start(coroutine_t *co, int epollFd, coroutine_body_t body,
+                    coroutine_done_handler_t doneHandler, void *context);
+
+/// <summary>
+///     Arms the coroutine's timer for a delay from now. Used by CO_AWAIT_DELAY.
+/// </summary>
+void Coroutine_SleepFor(coroutine_t *co, const struct timespec *delay);
+
+/// <summary>
+///     Arms the coroutine's timer for an absolute deadline. Used by CO_AWAIT_DEADLINE.
+/// </summary>
+void Coroutine_SleepUntil(coroutine_t *co, const struct timespec *deadline);
+
+/// <summary>
+///     Adds an fd to the epoll instance for the coroutine, with an optional timeout. Used by
+///     CO_AWAIT_FD. The fd must not already be on the epoll instance.
+/// </summary>
+void Coroutine_WaitFd(coroutine_t *co, int fd, uint32_t events, const struct timespec *timeout);
+
+/// <summary>
+///     Returns true if the last CO_AWAIT_FD ended with its timeout rather than the fd.
+/// </summary>
+bool Coroutine_TimedOut(const coroutine_t *co);
+
+/// <summary>
+///     Returns true from Coroutine_Start until the body reaches CO_END or CO_EXIT.
+/// </summary>
+bool Coroutine_Running(const coroutine_t *co);
+
+/// <summary>
+///     Abandons a running coroutine where it is suspended, without calling its done handler. It
+///     can be started again.
+/// </summary>
+void Coroutine_Cancel(coroutine_t *co);
+
+/// <summary>
+///     Cancels the coroutine and takes it off the epoll instance, so the next start may use
+///     another one.
+/// </summary>
+void Coroutine_Close(coroutine_t *co);
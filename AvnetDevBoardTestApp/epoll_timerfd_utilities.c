@@ -4,6 +4,49 @@
 #include <sys/timerfd.h>
 #include <applibs/log.h>
 #include "epoll_timerfd_utilities.h"
+#include "platform.h"
+
+static epoll_dispatch_stats_t dispatchStats;
+
+#ifdef EPOLL_TELEMETRY
+// Telemetry.  Events are tracked in a slot per fd, so a dispatch finds its slot without a search; a slot is
+// rebound when its fd is reused by another event.  Names are kept by event so they survive a new fd.
+#define EPOLL_TELEMETRY_MAX_FDS 64
+#define EPOLL_TELEMETRY_MAX_NAMES 32
+
+typedef struct {
+    const event_data_t *eventData;
+    const char *name;
+    uint32_t dispatches;
+    uint32_t overruns;
+    uint64_t totalNs;
+    uint64_t maxNs;
+} event_telemetry_t;
+
+typedef struct {
+    const event_data_t *eventData;
+    const char *name;
+} event_telemetry_name_t;
+
+static event_telemetry_t telemetry[EPOLL_TELEMETRY_MAX_FDS];
+static event_telemetry_name_t telemetryNames[EPOLL_TELEMETRY_MAX_NAMES];
+static event_telemetry_t *telemetryCurrent = NULL;
+static uint32_t telemetryWakeups = 0;
+static uint64_t telemetryWaitNs = 0;
+static uint64_t telemetryHandlerNs = 0;
+static long long telemetryStartNs = 0;
+#endif
+
+// Timer wheel.  Each slot is a circular list with the slot itself as the sentinel.  wheelTick is
+// the last tick processed; wheelArmedTick is the tick the timerfd is armed for.
+static wheel_timer_t wheelSlots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint32_t wheelLevelCount[TIMER_WHEEL_LEVELS];
+static uint64_t wheelTick = 0;
+static uint64_t wheelArmedTick = UINT64_MAX;
+static long long wheelBaseNs = 0;
+static int wheelTimerFd = -1;
+static bool wheelAdvancing = false;
+static timer_wheel_stats_t wheelStats;
 
 int CreateEpollFd(void)
 {
@@ -79,6 +122,51 @@ int SetTimerFdToSingleExpiry(int timerFd, const struct timespec *expiry)
     return 0;
 }
 
+static long long NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/// <summary>
+///     Charges missed timer expirations to the event being dispatched, if it owns the timer.
+/// </summary>
+static void RecordTelemetryOverruns(int timerFd, uint64_t overruns)
+{
+#ifdef EPOLL_TELEMETRY
+    if (telemetryCurrent != NULL && telemetryCurrent->eventData->fd == timerFd) {
+        telemetryCurrent->overruns += (uint32_t)overruns;
+    }
+#endif
+}
+
+#ifdef EPOLL_TELEMETRY
+/// <summary>
+///     Returns the telemetry slot of an event, binding the slot of its fd to it if another event
+///     used that fd before. Returns NULL for fds beyond the table.
+/// </summary>
+static event_telemetry_t *GetTelemetrySlot(const event_data_t *eventData)
+{
+    if (eventData->fd < 0 || eventData->fd >= EPOLL_TELEMETRY_MAX_FDS) {
+        return NULL;
+    }
+
+    event_telemetry_t *slot = &telemetry[eventData->fd];
+    if (slot->eventData != eventData) {
+        memset(slot, 0, sizeof(*slot));
+        slot->eventData = eventData;
+        for (int i = 0; i < EPOLL_TELEMETRY_MAX_NAMES; i++) {
+            if (telemetryNames[i].eventData == eventData) {
+                slot->name = telemetryNames[i].name;
+                break;
+            }
+        }
+    }
+    return slot;
+}
+#endif
+
 int ConsumeTimerFdEvent(int timerFd)
 {
     uint64_t timerData = 0;
@@ -88,9 +176,119 @@ int ConsumeTimerFdEvent(int timerFd)
         return -1;
     }
 
+    dispatchStats.timerExpirations += timerData;
+    if (timerData > 1) {
+        dispatchStats.timerOverruns += timerData - 1;
+        RecordTelemetryOverruns(timerFd, timerData - 1);
+    }
+
+    return 0;
+}
+
+static long long TimespecToNs(const struct timespec *time)
+{
+    return (long long)time->tv_sec * 1000000000LL + time->tv_nsec;
+}
+
+static struct timespec NsToTimespec(long long ns)
+{
+    struct timespec time = {.tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL};
+    return time;
+}
+
+/// <summary>
+///     Arms the timer for its deadline and period on the absolute monotonic clock.
+/// </summary>
+static int ArmTimerFdDeadline(int timerFd, const timer_deadline_t *timer)
+{
+    struct itimerspec newValue = {.it_value = timer->deadline, .it_interval = timer->period};
+
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &newValue, NULL) < 0) {
+        Log_Debug("ERROR: Could not set timerfd deadline: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    return 0;
+}
+
+int GetDeadlineAfter(const struct timespec *delay, struct timespec *outDeadline)
+{
+    struct timespec now;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) != 0) {
+        Log_Debug("ERROR: Could not read the monotonic clock: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    *outDeadline = NsToTimespec(TimespecToNs(&now) + TimespecToNs(delay));
     return 0;
 }
 
+int SetTimerFdToDeadline(int timerFd, timer_deadline_t *timer, const struct timespec *deadline,
+                         const struct timespec *period)
+{
+    static const struct timespec oneShot = {0, 0};
+
+    timer->deadline = *deadline;
+    timer->period = (period != NULL) ? *period : oneShot;
+    timer->expirations = 0;
+    timer->overruns = 0;
+
+    return ArmTimerFdDeadline(timerFd, timer);
+}
+
+int ConsumeTimerFdDeadline(int timerFd, timer_deadline_t *timer, uint64_t *outExpirations)
+{
+    uint64_t timerData = 0;
+
+    *outExpirations = 0;
+    if (read(timerFd, &timerData, sizeof(timerData)) == -1) {
+        // An earlier handler in the same batch may have rearmed the timer, leaving nothing to read
+        if (errno == EAGAIN) {
+            return 0;
+        }
+        Log_Debug("ERROR: Could not read timerfd %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    *outExpirations = timerData;
+    timer->expirations += timerData;
+    dispatchStats.timerExpirations += timerData;
+    if (timerData > 1) {
+        timer->overruns += timerData - 1;
+        dispatchStats.timerOverruns += timerData - 1;
+        RecordTelemetryOverruns(timerFd, timerData - 1);
+    }
+
+    long long periodNs = TimespecToNs(&timer->period);
+    if (periodNs > 0) {
+        timer->deadline =
+            NsToTimespec(TimespecToNs(&timer->deadline) + (long long)timerData * periodNs);
+    }
+
+    return 0;
+}
+
+int AdvanceTimerFdDeadline(int timerFd, timer_deadline_t *timer, const struct timespec *interval)
+{
+    long long intervalNs = TimespecToNs(interval);
+    long long deadlineNs = TimespecToNs(&timer->deadline) + intervalNs;
+
+    // Skip the deadlines that have already passed rather than firing once for each of them
+    long long lateNs = NowNs() - deadlineNs;
+    if (lateNs >= 0 && intervalNs > 0) {
+        long long missed = lateNs / intervalNs + 1;
+        deadlineNs += missed * intervalNs;
+        timer->overruns += (uint64_t)missed;
+        dispatchStats.timerOverruns += (uint64_t)missed;
+        RecordTelemetryOverruns(timerFd, (uint64_t)missed);
+    }
+
+    timer->deadline = NsToTimespec(deadlineNs);
+    timer->period = NsToTimespec(0);
+    return ArmTimerFdDeadline(timerFd, timer);
+}
+
 int CreateTimerFdAndAddToEpoll(int epollFd, const struct timespec *period,
                                event_data_t *persistentEventData, const uint32_t epollEventMask)
 {
@@ -118,8 +316,32 @@ int CreateTimerFdAndAddToEpoll(int epollFd, const struct timespec *period,
 
 int WaitForEventAndCallHandler(int epollFd)
 {
-    struct epoll_event event;
-    int numEventsOccurred = epoll_wait(epollFd, &event, 1, -1);
+    return WaitForEventsAndCallHandlers(epollFd, EPOLL_MAX_EVENTS_PER_WAIT);
+}
+
+int WaitForEventsAndCallHandlers(int epollFd, int maxEvents)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS_PER_WAIT];
+
+    if (maxEvents < 1) {
+        maxEvents = 1;
+    } else if (maxEvents > EPOLL_MAX_EVENTS_PER_WAIT) {
+        maxEvents = EPOLL_MAX_EVENTS_PER_WAIT;
+    }
+
+#ifdef EPOLL_TELEMETRY
+    long long waitStartNs = NowNs();
+    if (telemetryStartNs == 0) {
+        telemetryStartNs = waitStartNs;
+    }
+#endif
+
+    int numEventsOccurred = epoll_wait(epollFd, events, maxEvents, -1);
+
+#ifdef EPOLL_TELEMETRY
+    telemetryWaitNs += (uint64_t)(NowNs() - waitStartNs);
+    telemetryWakeups++;
+#endif
 
     if (numEventsOccurred == -1) {
         if (errno == EINTR) {
@@ -130,14 +352,480 @@ int WaitForEventAndCallHandler(int epollFd)
         return -1;
     }
 
-    if (numEventsOccurred == 1 && event.data.ptr != NULL) {
-        event_data_t *event_data = event.data.ptr;
-        event_data->eventHandler(event_data);
+    if (numEventsOccurred == 0) {
+        return 0;
+    }
+
+    dispatchStats.waits++;
+    dispatchStats.eventsPerWait[numEventsOccurred]++;
+    if ((uint32_t)numEventsOccurred > dispatchStats.maxEventsPerWait) {
+        dispatchStats.maxEventsPerWait = (uint32_t)numEventsOccurred;
+    }
+
+    // Handlers may consume or rearm other fds in this batch; each handler reads its own fd
+    // non-blocking, so an event made stale by an earlier handler is harmless.
+    for (int i = 0; i < numEventsOccurred; i++) {
+        event_data_t *event_data = events[i].data.ptr;
+        if (event_data != NULL && event_data->eventHandler != NULL) {
+#ifdef EPOLL_TELEMETRY
+            telemetryCurrent = GetTelemetrySlot(event_data);
+            long long handlerStartNs = NowNs();
+#endif
+            event_data->eventHandler(event_data);
+            dispatchStats.eventsDispatched++;
+#ifdef EPOLL_TELEMETRY
+            uint64_t handlerNs = (uint64_t)(NowNs() - handlerStartNs);
+            telemetryHandlerNs += handlerNs;
+            if (telemetryCurrent != NULL) {
+                telemetryCurrent->dispatches++;
+                telemetryCurrent->totalNs += handlerNs;
+                if (handlerNs > telemetryCurrent->maxNs) {
+                    telemetryCurrent->maxNs = handlerNs;
+                }
+            }
+            telemetryCurrent = NULL;
+#endif
+        }
     }
 
     return 0;
 }
 
+void GetEpollDispatchStats(epoll_dispatch_stats_t *outStats)
+{
+    *outStats = dispatchStats;
+}
+
+void ResetEpollDispatchStats(void)
+{
+    memset(&dispatchStats, 0, sizeof(dispatchStats));
+}
+
+void LogEpollDispatchStats(void)
+{
+    Log_Debug("INFO: Event loop: %u waits, %u handlers dispatched, %llu timer expirations, "
+              "%llu missed.\n",
+              dispatchStats.waits, dispatchStats.eventsDispatched,
+              (unsigned long long)dispatchStats.timerExpirations,
+              (unsigned long long)dispatchStats.timerOverruns);
+    ResetEpollDispatchStats();
+}
+
+void SetEventTelemetryName(const event_data_t *eventData, const char *name)
+{
+#ifdef EPOLL_TELEMETRY
+    int entry = -1;
+    for (int i = 0; i < EPOLL_TELEMETRY_MAX_NAMES; i++) {
+        if (telemetryNames[i].eventData == eventData) {
+            entry = i;
+            break;
+        }
+        if (entry < 0 && telemetryNames[i].eventData == NULL) {
+            entry = i;
+        }
+    }
+    if (entry < 0) {
+        Log_Debug("WARNING: No room to name event \"%s\" in the telemetry.\n", name);
+        return;
+    }
+    telemetryNames[entry].eventData = eventData;
+    telemetryNames[entry].name = name;
+
+    event_telemetry_t *slot = GetTelemetrySlot(eventData);
+    if (slot != NULL) {
+        slot->name = name;
+    }
+#endif
+}
+
+void LogEventLoopTelemetry(void)
+{
+#ifdef EPOLL_TELEMETRY
+    long long nowNs = NowNs();
+    double windowS = (telemetryStartNs != 0) ? (double)(nowNs - telemetryStartNs) / 1e9 : 0.0;
+    double handlerMs = (double)telemetryHandlerNs / 1e6;
+    double waitS = (double)telemetryWaitNs / 1e9;
+
+    // Whatever the loop did between waits outside a handler: the code around the wait in the
+    // main loop, such as starting a run, and the dispatch itself. The three add up to the window.
+    double outsideS = windowS - waitS - handlerMs / 1e3;
+    if (outsideS < 0) {
+        outsideS = 0;
+    }
+
+    Log_Debug("TELEMETRY: %.2f s: %u wakeups (%.1f/s), %.2f ms in handlers (%.3f%%), %.2f s waiting, "
+              "%.2f s outside handlers.\n",
+              windowS, telemetryWakeups, windowS > 0 ? telemetryWakeups / windowS : 0.0, handlerMs,
+              windowS > 0 ? handlerMs / 10.0 / windowS : 0.0, waitS, outsideS);
+    Log_Debug("TELEMETRY:  fd event              dispatches  total us    max us  overruns\n");
+    for (int fd = 0; fd < EPOLL_TELEMETRY_MAX_FDS; fd++) {
+        const event_telemetry_t *slot = &telemetry[fd];
+        if (slot->dispatches == 0 && slot->overruns == 0) {
+            continue;
+        }
+        Log_Debug("TELEMETRY: %3d %-18s %10u %9llu %9llu %9u\n", fd,
+                  (slot->name != NULL) ? slot->name : "-", slot->dispatches,
+                  (unsigned long long)(slot->totalNs / 1000), (unsigned long long)(slot->maxNs / 1000),
+                  slot->overruns);
+    }
+
+    // Keep the slots bound to their events and names; only the counts start again
+    for (int fd = 0; fd < EPOLL_TELEMETRY_MAX_FDS; fd++) {
+        telemetry[fd].dispatches = 0;
+        telemetry[fd].overruns = 0;
+        telemetry[fd].totalNs = 0;
+        telemetry[fd].maxNs = 0;
+    }
+    telemetryWakeups = 0;
+    telemetryWaitNs = 0;
+    telemetryHandlerNs = 0;
+    telemetryStartNs = nowNs;
+#endif
+}
+
+/// <summary>
+///     Returns the first tick at or after an absolute monotonic time, so a timer never fires early.
+/// </summary>
+static uint64_t WheelTickAt(long long ns)
+{
+    long long sinceBaseNs = ns - wheelBaseNs;
+    if (sinceBaseNs <= 0) {
+        return 0;
+    }
+    return (uint64_t)((sinceBaseNs + TIMER_WHEEL_TICK_NS - 1) / TIMER_WHEEL_TICK_NS);
+}
+
+/// <summary>
+///     Moves a timer's due time on past limitNs in whole periods, counting the periods skipped.
+///     Returns the number skipped.
+/// </summary>
+static uint64_t WheelSkipPassed(wheel_timer_t *timer, long long periodNs, long long limitNs)
+{
+    if (timer->dueNs > limitNs || periodNs <= 0) {
+        return 0;
+    }
+    long long skipped = (limitNs - timer->dueNs) / periodNs + 1;
+    timer->dueNs += skipped * periodNs;
+    wheelStats.overruns += (uint32_t)skipped;
+    dispatchStats.timerOverruns += (uint64_t)skipped;
+    return (uint64_t)skipped;
+}
+
+/// <summary>
+///     Links a timer into the slot for its expiry. Timers due before minTick are placed at
+///     minTick; timers beyond the last level are parked in the last level's furthest slot.
+/// </summary>
+static void WheelInsert(wheel_timer_t *timer, uint64_t minTick)
+{
+    uint64_t placement = (timer->expiryTick < minTick) ? minTick : timer->expiryTick;
+    uint64_t horizon = 1ull << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+    if (placement - wheelTick >= horizon) {
+        placement = wheelTick + horizon - 1;
+    }
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 &&
+           placement - wheelTick >= 1ull << (TIMER_WHEEL_SLOT_BITS * (level + 1))) {
+        level++;
+    }
+
+    wheel_timer_t *slot =
+        &wheelSlots[level][(placement >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)];
+    timer->next = slot;
+    timer->prev = slot->prev;
+    slot->prev->next = timer;
+    slot->prev = timer;
+    timer->level = level;
+    wheelLevelCount[level]++;
+}
+
+static void WheelUnlink(wheel_timer_t *timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->next = NULL;
+    timer->prev = NULL;
+    wheelLevelCount[timer->level]--;
+}
+
+/// <summary>
+///     Processes every tick up to target: cascades the higher levels as their slots come due and
+///     calls the handlers of the timers that expire. Stretches in which nothing can happen are
+///     skipped.
+/// </summary>
+static void WheelAdvance(uint64_t target)
+{
+    while (wheelTick < target) {
+        // With the lowest levels empty, nothing happens before the next boundary of the first
+        // level that has timers
+        int empty = 0;
+        while (empty < TIMER_WHEEL_LEVELS && wheelLevelCount[empty] == 0) {
+            empty++;
+        }
+        if (empty == TIMER_WHEEL_LEVELS) {
+            wheelTick = target;
+            break;
+        }
+        if (empty > 0) {
+            int bits = TIMER_WHEEL_SLOT_BITS * empty;
+            uint64_t beforeBoundary = (((wheelTick >> bits) + 1) << bits) - 1;
+            if (beforeBoundary >= target) {
+                wheelTick = target;
+                break;
+            }
+            wheelTick = beforeBoundary;
+        }
+
+        wheelTick++;
+
+        // Move the timers of every level whose slot starts at this tick down, highest first
+        for (int level = TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            int bits = TIMER_WHEEL_SLOT_BITS * level;
+            if ((wheelTick & ((1ull << bits) - 1)) != 0) {
+                continue;
+            }
+            wheel_timer_t *slot = &wheelSlots[level][(wheelTick >> bits) & (TIMER_WHEEL_SLOTS - 1)];
+            while (slot->next != slot) {
+                wheel_timer_t *timer = slot->next;
+                WheelUnlink(timer);
+                WheelInsert(timer, wheelTick);
+                wheelStats.cascades++;
+            }
+        }
+
+        wheel_timer_t *slot = &wheelSlots[0][wheelTick & (TIMER_WHEEL_SLOTS - 1)];
+        while (slot->next != slot) {
+            wheel_timer_t *timer = slot->next;
+            WheelUnlink(timer);
+
+            // Periodic timers are rearmed before the handler runs, so the handler can stop them.
+            // The period is kept in nanoseconds, so rounding to ticks does not accumulate. Like
+            // a timerfd, a timer that fell behind fires once and skips the periods that have
+            // passed, rather than firing for each of them.
+            timer->missed = 0;
+            if (timer->periodNs > 0) {
+                timer->dueNs += timer->periodNs;
+                timer->missed = WheelSkipPassed(
+                    timer, timer->periodNs, wheelBaseNs + (long long)target * TIMER_WHEEL_TICK_NS);
+                timer->expiryTick = WheelTickAt(timer->dueNs);
+                WheelInsert(timer, wheelTick + 1);
+            }
+            wheelStats.expirations++;
+            dispatchStats.timerExpirations++;
+            timer->handler(timer);
+        }
+    }
+}
+
+/// <summary>
+///     Returns the tick of the earliest armed timer, or UINT64_MAX if none is armed. The first
+///     occupied slot of each level holds that level's earliest timers.
+/// </summary>
+static uint64_t WheelNextExpiry(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (wheelLevelCount[level] == 0) {
+            continue;
+        }
+        uint64_t position = wheelTick >> (TIMER_WHEEL_SLOT_BITS * level);
+        // The current slot comes last: it can only hold timers a full turn of the level away
+        for (uint64_t i = 1; i <= TIMER_WHEEL_SLOTS; i++) {
+            wheel_timer_t *slot = &wheelSlots[level][(position + i) & (TIMER_WHEEL_SLOTS - 1)];
+            if (slot->next == slot) {
+                continue;
+            }
+            for (wheel_timer_t *timer = slot->next; timer != slot; timer = timer->next) {
+                if (timer->expiryTick < next) {
+                    next = timer->expiryTick;
+                }
+            }
+            break;
+        }
+    }
+    return next;
+}
+
+/// <summary>
+///     Arms the wheel's timerfd for the given tick, or disarms it for UINT64_MAX.
+/// </summary>
+static int WheelArm(uint64_t tick)
+{
+    struct itimerspec newValue = {.it_value = {0, 0}, .it_interval = {0, 0}};
+    if (tick != UINT64_MAX) {
+        long long ns = wheelBaseNs + (long long)tick * TIMER_WHEEL_TICK_NS;
+        newValue.it_value.tv_sec = ns / 1000000000LL;
+        newValue.it_value.tv_nsec = ns % 1000000000LL;
+    }
+
+    if (timerfd_settime(wheelTimerFd, TFD_TIMER_ABSTIME, &newValue, NULL) < 0) {
+        Log_Debug("ERROR: Could not set timer wheel timerfd: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+    wheelArmedTick = tick;
+    wheelStats.rearms++;
+    return 0;
+}
+
+static void WheelTimerEventHandler(event_data_t *eventData)
+{
+    if (ConsumeTimerFdEvent(wheelTimerFd) != 0) {
+        return;
+    }
+
+    wheelStats.wakeups++;
+    wheelArmedTick = UINT64_MAX;
+    wheelAdvancing = true;
+    WheelAdvance((uint64_t)((NowNs() - wheelBaseNs) / TIMER_WHEEL_TICK_NS));
+    wheelAdvancing = false;
+
+    uint64_t next = WheelNextExpiry();
+    if (next != UINT64_MAX) {
+        WheelArm(next);
+    }
+}
+
+static event_data_t wheelEventData = {.eventHandler = &WheelTimerEventHandler};
+
+int CreateTimerWheel(int epollFd)
+{
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+            wheelSlots[level][i].next = &wheelSlots[level][i];
+            wheelSlots[level][i].prev = &wheelSlots[level][i];
+        }
+        wheelLevelCount[level] = 0;
+    }
+    wheelBaseNs = NowNs();
+    wheelTick = 0;
+    wheelArmedTick = UINT64_MAX;
+
+    static const struct timespec disarmed = {0, 0};
+    wheelTimerFd = CreateTimerFdAndAddToEpoll(epollFd, &disarmed, &wheelEventData, EPOLLIN);
+    if (wheelTimerFd < 0) {
+        return -1;
+    }
+    SetEventTelemetryName(&wheelEventData, "TimerWheel");
+    return 0;
+}
+
+/// <summary>
+///     Links a timer into the wheel for its due time and moves the timerfd deadline forward if
+///     the timer is now the earliest.
+/// </summary>
+static int WheelStart(wheel_timer_t *timer)
+{
+    timer->expiryTick = WheelTickAt(timer->dueNs);
+    if (timer->expiryTick <= wheelTick) {
+        timer->expiryTick = wheelTick + 1;
+    }
+
+    // Timers started from a wheel timer handler are armed once the wheel has been advanced
+    WheelInsert(timer, wheelTick + 1);
+    if (!wheelAdvancing && timer->expiryTick < wheelArmedTick) {
+        return WheelArm(timer->expiryTick);
+    }
+    return 0;
+}
+
+/// <summary>
+///     Takes a timer off the wheel for a restart. An empty wheel that is not being advanced moves
+///     straight to the present, since nothing is due in between; while WheelAdvance is catching
+///     up, the ticks up to its target have not been processed yet, so wheelTick stays put.
+/// </summary>
+static int WheelPrepareStart(wheel_timer_t *timer)
+{
+    if (wheelTimerFd < 0) {
+        Log_Debug("ERROR: The timer wheel has not been created.\n");
+        return -1;
+    }
+
+    if (timer->next != NULL) {
+        WheelUnlink(timer);
+    }
+
+    bool wheelEmpty = true;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        wheelEmpty = wheelEmpty && wheelLevelCount[level] == 0;
+    }
+    uint64_t nowTick = (uint64_t)((NowNs() - wheelBaseNs) / TIMER_WHEEL_TICK_NS);
+    if (wheelEmpty && !wheelAdvancing && nowTick > wheelTick) {
+        wheelTick = nowTick;
+    }
+    timer->missed = 0;
+    return 0;
+}
+
+static long long PeriodToNs(const struct timespec *period)
+{
+    return (period != NULL) ? TimespecToNs(period) : 0;
+}
+
+int StartWheelTimer(wheel_timer_t *timer, const struct timespec *delay,
+                    const struct timespec *period)
+{
+    if (WheelPrepareStart(timer) != 0) {
+        return -1;
+    }
+    timer->dueNs = NowNs() + TimespecToNs(delay);
+    timer->periodNs = PeriodToNs(period);
+    return WheelStart(timer);
+}
+
+int StartWheelTimerAt(wheel_timer_t *timer, const struct timespec *deadline,
+                      const struct timespec *period)
+{
+    if (WheelPrepareStart(timer) != 0) {
+        return -1;
+    }
+    timer->dueNs = TimespecToNs(deadline);
+    timer->periodNs = PeriodToNs(period);
+    return WheelStart(timer);
+}
+
+int AdvanceWheelTimer(wheel_timer_t *timer, const struct timespec *interval)
+{
+    long long lastDueNs = timer->dueNs;
+    if (WheelPrepareStart(timer) != 0) {
+        return -1;
+    }
+    long long intervalNs = TimespecToNs(interval);
+    timer->dueNs = lastDueNs + intervalNs;
+    timer->periodNs = 0;
+    WheelSkipPassed(timer, intervalNs, NowNs());
+    return WheelStart(timer);
+}
+
+void StopWheelTimer(wheel_timer_t *timer)
+{
+    // The timerfd stays armed; a wakeup with nothing due just rearms it for the next timer
+    if (timer->next != NULL) {
+        WheelUnlink(timer);
+    }
+}
+
+bool IsWheelTimerArmed(const wheel_timer_t *timer)
+{
+    return timer->next != NULL;
+}
+
+void GetTimerWheelStats(timer_wheel_stats_t *outStats)
+{
+    *outStats = wheelStats;
+}
+
+void ResetTimerWheelStats(void)
+{
+    memset(&wheelStats, 0, sizeof(wheelStats));
+}
+
+void CloseTimerWheel(void)
+{
+    CloseFdAndPrintError(wheelTimerFd, "TimerWheel");
+    wheelTimerFd = -1;
+}
+
 void CloseFdAndPrintError(int fd, const char *fdName)
 {
     if (fd >= 0) {
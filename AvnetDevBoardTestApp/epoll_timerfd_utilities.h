@@ -1,4 +1,6 @@
 #pragma once
+#include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include <sys/epoll.h>
 #include <unistd.h>
@@ -29,6 +31,139 @@ typedef struct event_data {
     int fd;
 } event_data_t;
 
+/// <summary>
+/// Maximum number of ready events drained from the epoll instance by a single wait.
+/// </summary>
+#define EPOLL_MAX_EVENTS_PER_WAIT 16
+
+/// <summary>
+/// Dispatch statistics gathered by WaitForEventsAndCallHandlers.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// Number of epoll_wait calls that returned at least one event
+    /// </summary>
+    uint32_t waits;
+    /// <summary>
+    /// Total number of handlers dispatched
+    /// </summary>
+    uint32_t eventsDispatched;
+    /// <summary>
+    /// Largest number of events returned by a single wait
+    /// </summary>
+    uint32_t maxEventsPerWait;
+    /// <summary>
+    /// eventsPerWait[n] counts the waits that returned n events
+    /// </summary>
+    uint32_t eventsPerWait[EPOLL_MAX_EVENTS_PER_WAIT + 1];
+    /// <summary>
+    /// Number of timer expirations read by ConsumeTimerFdEvent and ConsumeTimerFdDeadline
+    /// </summary>
+    uint64_t timerExpirations;
+    /// <summary>
+    /// Number of those expirations that were missed: a timer that expired more than once before
+    /// its handler read it, or a chained deadline that had already passed when it was set
+    /// </summary>
+    uint64_t timerOverruns;
+} epoll_dispatch_stats_t;
+
+/// <summary>
+/// A timer scheduled on absolute CLOCK_MONOTONIC deadlines. Each deadline is computed from the
+/// previous one rather than from the time the handler ran, so a periodic or chained timer keeps
+/// its phase however late its handlers run.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// The next deadline on CLOCK_MONOTONIC
+    /// </summary>
+    struct timespec deadline;
+    /// <summary>
+    /// The period, or zero for a one-shot timer
+    /// </summary>
+    struct timespec period;
+    /// <summary>
+    /// Number of expirations since the timer was set
+    /// </summary>
+    uint64_t expirations;
+    /// <summary>
+    /// Number of expirations missed since the timer was set
+    /// </summary>
+    uint64_t overruns;
+} timer_deadline_t;
+
+/// <summary>
+/// Resolution of the timer wheel. Wheel timers expire on a tick boundary, so they fire up to one
+/// tick after their due time.
+/// </summary>
+#define TIMER_WHEEL_TICK_NS 1000000
+
+/// <summary>
+/// The timer wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots. Level n holds the
+/// timers due in 64^n to 64^(n+1) ticks, so the four levels cover 2^24 ticks (about 4.6 hours at
+/// 1 ms); timers further out are parked in the last level until they come within range.
+/// </summary>
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+/// Forward declaration of the timer type passed to the wheel timer handlers.
+struct wheel_timer;
+
+/// <summary>
+///     Function signature for wheel timer handlers.
+/// </summary>
+/// <param name="timer">The timer that expired</param>
+typedef void (*wheel_timer_handler_t)(struct wheel_timer *timer);
+
+/// <summary>
+/// A logical timer multiplexed with others onto the single timerfd of the timer wheel.
+/// Zero-initialize it and set the handler; the other fields belong to the wheel. Like
+/// event_data_t, it must stay in memory while it is armed.
+/// </summary>
+typedef struct wheel_timer {
+    /// <summary>
+    /// Called when the timer expires
+    /// </summary>
+    wheel_timer_handler_t handler;
+    /// <summary>
+    /// Periods of a periodic timer that passed while the event loop was busy and were skipped
+    /// after this expiry, as for a timerfd read that returns more than one. Valid in the handler.
+    /// </summary>
+    uint64_t missed;
+    struct wheel_timer *next;
+    struct wheel_timer *prev;
+    long long dueNs;
+    long long periodNs;
+    uint64_t expiryTick;
+    int level;
+} wheel_timer_t;
+
+/// <summary>
+/// Statistics gathered by the timer wheel.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// Number of times the wheel's timerfd woke the event loop
+    /// </summary>
+    uint32_t wakeups;
+    /// <summary>
+    /// Number of timer handlers called
+    /// </summary>
+    uint32_t expirations;
+    /// <summary>
+    /// Number of timers moved down a level as their due time came within range
+    /// </summary>
+    uint32_t cascades;
+    /// <summary>
+    /// Number of timerfd_settime calls made to move the wheel's deadline
+    /// </summary>
+    uint32_t rearms;
+    /// <summary>
+    /// Number of timer deadlines skipped because they passed while the event loop was busy
+    /// </summary>
+    uint32_t overruns;
+} timer_wheel_stats_t;
+
 /// <summary>
 ///    Creates an epoll instance.
 /// </summary>
@@ -80,6 +215,49 @@ int SetTimerFdToSingleExpiry(int timerFd, const struct timespec *expiry);
 /// <returns>0 on success, or -1 on failure</returns>
 int ConsumeTimerFdEvent(int timerFd);
 
+/// <summary>
+///     Returns the CLOCK_MONOTONIC time a delay from now, as a deadline for SetTimerFdToDeadline.
+/// </summary>
+/// <param name="delay">The delay from now</param>
+/// <param name="outDeadline">Receives the deadline</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int GetDeadlineAfter(const struct timespec *delay, struct timespec *outDeadline);
+
+/// <summary>
+///     Arms a timer to expire at an absolute CLOCK_MONOTONIC deadline and, if period is not
+///     zero, every period after it. The expiration and overrun counts start again from zero.
+/// </summary>
+/// <param name="timerFd">Timer file descriptor</param>
+/// <param name="timer">Receives the schedule; must stay in memory while the timer runs</param>
+/// <param name="deadline">The first deadline</param>
+/// <param name="period">The period, or NULL or zero for a one-shot timer</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int SetTimerFdToDeadline(int timerFd, timer_deadline_t *timer, const struct timespec *deadline,
+                         const struct timespec *period);
+
+/// <summary>
+///     Consumes the event of a timer set with SetTimerFdToDeadline. Moves a periodic timer's
+///     deadline on by the number of expirations and counts all but one of them as overruns.
+/// </summary>
+/// <param name="timerFd">Timer file descriptor</param>
+/// <param name="timer">The timer's schedule</param>
+/// <param name="outExpirations">
+///     Receives the number of expirations since the last read; 0 if the event was already consumed
+/// </param>
+/// <returns>0 on success, or -1 on failure</returns>
+int ConsumeTimerFdDeadline(int timerFd, timer_deadline_t *timer, uint64_t *outExpirations);
+
+/// <summary>
+///     Chains a one-shot timer to a deadline an interval after its last one, so a sequence of
+///     steps of different lengths does not drift. Deadlines that have already passed are skipped
+///     in whole intervals and counted as overruns.
+/// </summary>
+/// <param name="timerFd">Timer file descriptor</param>
+/// <param name="timer">The timer's schedule</param>
+/// <param name="interval">Time from the last deadline to the next</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int AdvanceTimerFdDeadline(int timerFd, timer_deadline_t *timer, const struct timespec *interval);
+
 /// <summary>
 ///     Creates a timerfd and adds it to an epoll instance.
 /// </summary>
@@ -93,12 +271,122 @@ int CreateTimerFdAndAddToEpoll(int epollFd, const struct timespec *period,
                                event_data_t *persistentEventData, const uint32_t epollEventMask);
 
 /// <summary>
-///     Waits for an event on an epoll instance and triggers the handler.
+///     Waits for events on an epoll instance and triggers the handler of every ready event.
+///     Up to EPOLL_MAX_EVENTS_PER_WAIT events are drained per call.
 /// </summary>
 /// <param name="epollFd">Epoll file descriptor</param>
 /// <returns>0 on success, or -1 on failure</returns>
 int WaitForEventAndCallHandler(int epollFd);
 
+/// <summary>
+///     Waits for up to maxEvents ready events on an epoll instance and triggers their handlers
+///     in one pass.
+/// </summary>
+/// <param name="epollFd">Epoll file descriptor</param>
+/// <param name="maxEvents">Number of events to drain per wait, clamped to
+/// [1, EPOLL_MAX_EVENTS_PER_WAIT]</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int WaitForEventsAndCallHandlers(int epollFd, int maxEvents);
+
+/// <summary>
+///     Copies the dispatch statistics gathered since startup or the last reset.
+/// </summary>
+/// <param name="outStats">Receives the statistics</param>
+void GetEpollDispatchStats(epoll_dispatch_stats_t *outStats);
+
+/// <summary>
+///     Clears the dispatch statistics.
+/// </summary>
+void ResetEpollDispatchStats(void);
+
+/// <summary>
+///     Logs the dispatch and timer overrun statistics gathered since the last call, then clears them.
+/// </summary>
+void LogEpollDispatchStats(void);
+
+/// <summary>
+///     Names an event in the telemetry dump. Call it once the event is registered; the name is kept
+///     if the event is registered again on another fd. Does nothing unless EPOLL_TELEMETRY is
+///     defined in platform.h.
+/// </summary>
+/// <param name="eventData">The event data, as registered</param>
+/// <param name="name">A name that stays valid, such as a string literal</param>
+void SetEventTelemetryName(const event_data_t *eventData, const char *name);
+
+/// <summary>
+///     Logs the time the event loop spent waiting, in handlers and outside both, and for each event
+///     its dispatch count, total and longest handler time and missed timer expirations, then clears
+///     them. Does nothing unless EPOLL_TELEMETRY is defined in platform.h.
+/// </summary>
+void LogEventLoopTelemetry(void);
+
+/// <summary>
+///     Creates the timer wheel: one timerfd on the epoll instance, always armed at the earliest
+///     deadline of the wheel timers.
+/// </summary>
+/// <param name="epollFd">Epoll file descriptor</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int CreateTimerWheel(int epollFd);
+
+/// <summary>
+///     Starts or restarts a wheel timer. Starting and stopping a timer take constant time and
+///     make at most one timerfd_settime call.
+/// </summary>
+/// <param name="timer">The timer, with its handler set</param>
+/// <param name="delay">Time until the first expiry</param>
+/// <param name="period">Time between later expiries, or NULL or zero for a one-shot timer</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int StartWheelTimer(wheel_timer_t *timer, const struct timespec *delay,
+                    const struct timespec *period);
+
+/// <summary>
+///     Starts or restarts a wheel timer at an absolute CLOCK_MONOTONIC deadline.
+/// </summary>
+/// <param name="timer">The timer, with its handler set</param>
+/// <param name="deadline">The first expiry</param>
+/// <param name="period">Time between later expiries, or NULL or zero for a one-shot timer</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int StartWheelTimerAt(wheel_timer_t *timer, const struct timespec *deadline,
+                      const struct timespec *period);
+
+/// <summary>
+///     Chains a one-shot wheel timer to a deadline an interval after its last one, so a sequence
+///     of steps of different lengths does not drift. Deadlines that have already passed are
+///     skipped in whole intervals and counted as overruns.
+/// </summary>
+/// <param name="timer">The timer, usually from its own handler</param>
+/// <param name="interval">Time from the last deadline to the next</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int AdvanceWheelTimer(wheel_timer_t *timer, const struct timespec *interval);
+
+/// <summary>
+///     Stops a wheel timer. Stopping a timer that is not armed does nothing.
+/// </summary>
+/// <param name="timer">The timer</param>
+void StopWheelTimer(wheel_timer_t *timer);
+
+/// <summary>
+///     Returns true if the wheel timer is armed.
+/// </summary>
+/// <param name="timer">The timer</param>
+bool IsWheelTimerArmed(const wheel_timer_t *timer);
+
+/// <summary>
+///     Copies the timer wheel statistics gathered since startup or the last reset.
+/// </summary>
+/// <param name="outStats">Receives the statistics</param>
+void GetTimerWheelStats(timer_wheel_stats_t *outStats);
+
+/// <summary>
+///     Clears the timer wheel statistics.
+/// </summary>
+void ResetTimerWheelStats(void);
+
+/// <summary>
+///     Closes the timer wheel's timerfd. Timers still armed are dropped.
+/// </summary>
+void CloseTimerWheel(void);
+
 /// <summary>
 ///     Closes a file descriptor and prints an error on failure.
 /// </summary>
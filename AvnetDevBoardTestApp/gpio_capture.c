@@ -0,0 +1,164 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include <applibs/gpio.h>
+#include <applibs/log.h>
+
+#include "button_utility.h"
+#include "gpio_capture.h"
+#include "gpio_pool.h"
+
+// Capture ring. runHead counts every run written; the ring holds the last GPIO_CAPTURE_MAX_RUNS.
+static GpioCaptureRun runs[GPIO_CAPTURE_MAX_RUNS];
+static uint32_t runHead = 0;
+
+// Description of the last capture
+static GPIO_Id capturedGpios[GPIO_CAPTURE_MAX_GPIOS];
+static uint32_t capturedCount = 0;
+static uint32_t totalSamples = 0;
+static uint32_t captureUs = 0;
+
+/// <summary>
+///     Returns the microseconds since the given time.
+/// </summary>
+static uint32_t MicrosecondsSince(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+int GpioCapture_Run(const GPIO_Id *gpios, size_t count, uint32_t windowMs)
+{
+    int fds[GPIO_CAPTURE_MAX_GPIOS];
+
+    if (count > GPIO_CAPTURE_MAX_GPIOS) {
+        Log_Debug("ERROR: Cannot capture more than %d GPIOs.\n", GPIO_CAPTURE_MAX_GPIOS);
+        return -1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        fds[i] = ButtonUtility_GetFd(gpios[i]);
+        if (fds[i] < 0) {
+            fds[i] = GpioPool_OpenAsInput(gpios[i]);
+        }
+        if (fds[i] < 0) {
+            Log_Debug("ERROR: Could not open GPIO_%d for capture: %s (%d).\n", gpios[i],
+                      strerror(errno), errno);
+            return -1;
+        }
+        capturedGpios[i] = gpios[i];
+    }
+
+    capturedCount = (uint32_t)count;
+    runHead = 0;
+    totalSamples = 0;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t windowUs = windowMs * 1000u;
+    uint32_t nowUs = 0;
+    GpioCaptureRun *current = NULL;
+
+    do {
+        uint32_t state = 0;
+        for (size_t i = 0; i < count; i++) {
+            GPIO_Value_Type value;
+            if (GPIO_GetValue(fds[i], &value) != 0) {
+                Log_Debug("ERROR: Could not read GPIO_%d during capture: %s (%d).\n", gpios[i],
+                          strerror(errno), errno);
+                return -1;
+            }
+            state |= (uint32_t)(value == GPIO_Value_High) << i;
+        }
+
+        // Extend the current run, or start a new one when the state changes
+        if (current != NULL && current->state == state) {
+            current->samples++;
+        } else {
+            current = &runs[runHead % GPIO_CAPTURE_MAX_RUNS];
+            current->startUs = nowUs;
+            current->samples = 1;
+            current->state = state;
+            runHead++;
+        }
+        totalSamples++;
+        nowUs = MicrosecondsSince(&start);
+    } while (nowUs < windowUs);
+
+    captureUs = nowUs;
+    return 0;
+}
+
+/// <summary>
+///     Appends a 32-bit little-endian word to the buffer.
+/// </summary>
+static size_t PutWord(uint8_t *buffer, size_t offset, uint32_t word)
+{
+    buffer[offset] = (uint8_t)word;
+    buffer[offset + 1] = (uint8_t)(word >> 8);
+    buffer[offset + 2] = (uint8_t)(word >> 16);
+    buffer[offset + 3] = (uint8_t)(word >> 24);
+    return offset + 4;
+}
+
+// Runs per dump line, and the longest line: the header with every GPIO id is longer than a line of runs
+#define CAPTURE_RUNS_PER_LINE 4
+#define CAPTURE_LINE_MAX_BYTES (GPIO_CAPTURE_HEADER_BYTES + GPIO_CAPTURE_MAX_GPIOS)
+
+/// <summary>
+///     Logs a block of at most CAPTURE_LINE_MAX_BYTES bytes as one hex line.
+/// </summary>
+static void LogHexLine(const uint8_t *bytes, size_t length)
+{
+    static const char digits[] = "0123456789abcdef";
+    char line[2 * CAPTURE_LINE_MAX_BYTES + 1];
+
+    for (size_t i = 0; i < length; i++) {
+        line[2 * i] = digits[bytes[i] >> 4];
+        line[2 * i + 1] = digits[bytes[i] & 0xf];
+    }
+    line[2 * length] = '\0';
+    Log_Debug("CAPTURE: %s\n", line);
+}
+
+void GpioCapture_Dump(void)
+{
+    uint32_t stored = runHead < GPIO_CAPTURE_MAX_RUNS ? runHead : GPIO_CAPTURE_MAX_RUNS;
+    uint32_t first = runHead - stored;
+
+    if (runHead > GPIO_CAPTURE_MAX_RUNS) {
+        Log_Debug("INFO: Capture ring overflowed, the first %u runs were dropped.\n",
+                  runHead - GPIO_CAPTURE_MAX_RUNS);
+    }
+    Log_Debug("INFO: Capture of %u GPIOs: %u samples in %u runs over %u us.\n", capturedCount,
+              totalSamples, stored, captureUs);
+
+    uint8_t header[GPIO_CAPTURE_HEADER_BYTES + GPIO_CAPTURE_MAX_GPIOS];
+    size_t length = PutWord(header, 0, GPIO_CAPTURE_MAGIC);
+    length = PutWord(header, length, capturedCount);
+    length = PutWord(header, length, stored);
+    length = PutWord(header, length, totalSamples);
+    length = PutWord(header, length, captureUs);
+    for (uint32_t i = 0; i < capturedCount; i++) {
+        header[length++] = (uint8_t)capturedGpios[i];
+    }
+    LogHexLine(header, length);
+
+    uint8_t line[CAPTURE_RUNS_PER_LINE * GPIO_CAPTURE_RUN_BYTES];
+    length = 0;
+    for (uint32_t i = first; i < runHead; i++) {
+        const GpioCaptureRun *run = &runs[i % GPIO_CAPTURE_MAX_RUNS];
+        length = PutWord(line, length, run->startUs);
+        length = PutWord(line, length, run->samples);
+        length = PutWord(line, length, run->state);
+        if (length == sizeof(line)) {
+            LogHexLine(line, length);
+            length = 0;
+        }
+    }
+    if (length > 0) {
+        LogHexLine(line, length);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <applibs/gpio.h>
+
+/// <summary>
+///     Maximum number of GPIOs sampled together; each is one bit of the sampled state.
+/// </summary>
+#define GPIO_CAPTURE_MAX_GPIOS 32
+
+/// <summary>
+///     Number of runs the capture ring holds. When it is full the oldest runs are dropped.
+/// </summary>
+#define GPIO_CAPTURE_MAX_RUNS 1024
+
+/// <summary>
+///     First four bytes of a dump.
+/// </summary>
+#define GPIO_CAPTURE_MAGIC 0x50414347u // "GCAP"
+
+/// <summary>
+///     Bytes in the fixed part of the dump header, before the GPIO ids, and in each dumped run.
+///     HostTools/capture2vcd includes this file to decode the dump.
+/// </summary>
+#define GPIO_CAPTURE_HEADER_BYTES 20
+#define GPIO_CAPTURE_RUN_BYTES 12
+
+/// <summary>
+///     One run of identical samples. Runs are dumped as these three little-endian words.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     Time of the first sample of the run, in microseconds from the start of the capture
+    /// </summary>
+    uint32_t startUs;
+    /// <summary>
+    ///     Number of consecutive samples with this state
+    /// </summary>
+    uint32_t samples;
+    /// <summary>
+    ///     Sampled levels, bit n for the n-th captured GPIO
+    /// </summary>
+    uint32_t state;
+} GpioCaptureRun;
+
+/// <summary>
+///     Samples the inputs as fast as they can be read for windowMs and stores the samples in the
+///     capture ring, one entry per run of identical samples. Buttons are read through the fds
+///     the button utility holds; other GPIOs are taken as inputs from the GPIO pool.
+/// </summary>
+/// <returns>0 on success, or -1 if a GPIO could not be opened or read.</returns>
+int GpioCapture_Run(const GPIO_Id *gpios, size_t count, uint32_t windowMs);
+
+/// <summary>
+///     Logs the last capture as hex lines prefixed with "CAPTURE: ". The bytes are a header
+///     (magic, GPIO count, run count, total samples and capture length in microseconds, all
+///     32-bit little-endian, then one byte per GPIO id) followed by the runs, oldest first.
+///     HostTools/capture2vcd converts a log holding these lines to a VCD file.
+/// </summary>
+void GpioCapture_Dump(void);
@@ -0,0 +1,197 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <applibs/gpio.h>
+#include <applibs/log.h>
+
+#include "epoll_timerfd_utilities.h"
+#include "gpio_pool.h"
+
+/// <summary>
+///     One open GPIO.
+/// </summary>
+typedef struct {
+    GPIO_Id gpioId;
+    int fd;
+    GpioPool_Direction direction;
+    GPIO_Value_Type level;
+} GpioPool_Slot;
+
+static GpioPool_Slot slots[GPIO_POOL_MAX_HANDLES];
+static int slotCount = 0;
+
+// Dense GPIO_Id -> slot table. Entries hold the slot index plus one so zero means "not pooled".
+static uint8_t slotIndex[GPIO_POOL_MAX_GPIO_ID];
+
+static GpioPool_Stats stats;
+
+/// <summary>
+///     Finds the slot for a GPIO, creating an empty one if create is set.
+/// </summary>
+static GpioPool_Slot *GetSlot(GPIO_Id gpioId, bool create)
+{
+    if (gpioId < 0 || gpioId >= GPIO_POOL_MAX_GPIO_ID) {
+        Log_Debug("ERROR: GPIO_%d is outside the pool range.\n", gpioId);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (slotIndex[gpioId] != 0) {
+        return &slots[slotIndex[gpioId] - 1];
+    }
+    if (!create) {
+        errno = EBADF;
+        return NULL;
+    }
+    if (slotCount >= GPIO_POOL_MAX_HANDLES) {
+        Log_Debug("ERROR: GPIO pool is full, cannot open GPIO_%d.\n", gpioId);
+        errno = ENOSPC;
+        return NULL;
+    }
+
+    GpioPool_Slot *slot = &slots[slotCount++];
+    slot->gpioId = gpioId;
+    slot->fd = -1;
+    slot->direction = GpioPool_Direction_Closed;
+    slotIndex[gpioId] = (uint8_t)slotCount;
+    return slot;
+}
+
+static void CloseSlot(GpioPool_Slot *slot)
+{
+    if (slot->direction != GpioPool_Direction_Closed) {
+        CloseFdAndPrintError(slot->fd, "Pooled GPIO");
+        stats.closes++;
+    }
+    slot->fd = -1;
+    slot->direction = GpioPool_Direction_Closed;
+}
+
+int GpioPool_OpenAsOutput(GPIO_Id gpioId, GPIO_Value_Type initialValue)
+{
+    GpioPool_Slot *slot = GetSlot(gpioId, true);
+    if (slot == NULL) {
+        return -1;
+    }
+
+    if (slot->direction == GpioPool_Direction_Output) {
+        stats.reuses++;
+        // Always drive the requested level: the caller may have written the fd directly.
+        if (GPIO_SetValue(slot->fd, initialValue) != 0) {
+            return -1;
+        }
+        slot->level = initialValue;
+        return slot->fd;
+    }
+
+    if (slot->direction == GpioPool_Direction_Input) {
+        stats.directionChanges++;
+        CloseSlot(slot);
+    }
+
+    stats.opens++;
+    slot->fd = GPIO_OpenAsOutput(gpioId, GPIO_OutputMode_PushPull, initialValue);
+    if (slot->fd < 0) {
+        Log_Debug("ERROR: Could not open GPIO_%d: %s (%d).\n", gpioId, strerror(errno), errno);
+        return -1;
+    }
+    slot->direction = GpioPool_Direction_Output;
+    slot->level = initialValue;
+    return slot->fd;
+}
+
+int GpioPool_OpenAsInput(GPIO_Id gpioId)
+{
+    GpioPool_Slot *slot = GetSlot(gpioId, true);
+    if (slot == NULL) {
+        return -1;
+    }
+
+    if (slot->direction == GpioPool_Direction_Input) {
+        stats.reuses++;
+        return slot->fd;
+    }
+
+    if (slot->direction == GpioPool_Direction_Output) {
+        stats.directionChanges++;
+        CloseSlot(slot);
+    }
+
+    stats.opens++;
+    slot->fd = GPIO_OpenAsInput(gpioId);
+    if (slot->fd < 0) {
+        Log_Debug("ERROR: Could not open GPIO_%d: %s (%d).\n", gpioId, strerror(errno), errno);
+        return -1;
+    }
+    slot->direction = GpioPool_Direction_Input;
+    return slot->fd;
+}
+
+int GpioPool_SetValue(GPIO_Id gpioId, GPIO_Value_Type value)
+{
+    GpioPool_Slot *slot = GetSlot(gpioId, false);
+    if (slot == NULL || slot->direction != GpioPool_Direction_Output) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (slot->level == value) {
+        stats.writesSkipped++;
+        return 0;
+    }
+
+    if (GPIO_SetValue(slot->fd, value) != 0) {
+        return -1;
+    }
+    slot->level = value;
+    return 0;
+}
+
+int GpioPool_GetValue(GPIO_Id gpioId, GPIO_Value_Type *outValue)
+{
+    GpioPool_Slot *slot = GetSlot(gpioId, false);
+    if (slot == NULL || slot->direction == GpioPool_Direction_Closed) {
+        errno = EBADF;
+        return -1;
+    }
+
+    return GPIO_GetValue(slot->fd, outValue);
+}
+
+GpioPool_Direction GpioPool_GetDirection(GPIO_Id gpioId)
+{
+    if (gpioId < 0 || gpioId >= GPIO_POOL_MAX_GPIO_ID || slotIndex[gpioId] == 0) {
+        return GpioPool_Direction_Closed;
+    }
+    return slots[slotIndex[gpioId] - 1].direction;
+}
+
+void GpioPool_Release(GPIO_Id gpioId)
+{
+    if (gpioId >= 0 && gpioId < GPIO_POOL_MAX_GPIO_ID && slotIndex[gpioId] != 0) {
+        CloseSlot(&slots[slotIndex[gpioId] - 1]);
+    }
+}
+
+void GpioPool_CloseAll(void)
+{
+    for (int i = 0; i < slotCount; i++) {
+        CloseSlot(&slots[i]);
+    }
+}
+
+void GpioPool_GetStats(GpioPool_Stats *outStats)
+{
+    *outStats = stats;
+}
+
+void GpioPool_LogStats(void)
+{
+    // Every reuse saves an open and the close that would have followed it.
+    Log_Debug("INFO: GPIO pool: %u opens, %u closes, %u direction changes, %u handles reused "
+              "(%u open/close calls saved), %u redundant writes skipped.\n",
+              stats.opens, stats.closes, stats.directionChanges, stats.reuses, stats.reuses * 2,
+              stats.writesSkipped);
+    memset(&stats, 0, sizeof(stats));
+}
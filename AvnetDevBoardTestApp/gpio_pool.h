@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <applibs/gpio.h>
+
+/// <summary>
+///     GPIO_Id values below this limit can be held by the pool.
+/// </summary>
+#define GPIO_POOL_MAX_GPIO_ID 96
+
+/// <summary>
+///     Maximum number of GPIOs the pool can hold open at the same time.
+/// </summary>
+#define GPIO_POOL_MAX_HANDLES 64
+
+/// <summary>
+///     Direction a pooled GPIO is currently open in.
+/// </summary>
+typedef enum {
+    GpioPool_Direction_Closed = 0,
+    GpioPool_Direction_Input = 1,
+    GpioPool_Direction_Output = 2
+} GpioPool_Direction;
+
+/// <summary>
+///     Open/close and write counters kept by the pool.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     GPIO_OpenAsInput/GPIO_OpenAsOutput calls made
+    /// </summary>
+    uint32_t opens;
+    /// <summary>
+    ///     close calls made
+    /// </summary>
+    uint32_t closes;
+    /// <summary>
+    ///     Requests served by a handle that was already open in the right direction
+    /// </summary>
+    uint32_t reuses;
+    /// <summary>
+    ///     Handles closed and reopened because a different direction was requested
+    /// </summary>
+    uint32_t directionChanges;
+    /// <summary>
+    ///     GpioPool_SetValue calls skipped because the output was already at that level
+    /// </summary>
+    uint32_t writesSkipped;
+} GpioPool_Stats;
+
+/// <summary>
+///     Returns an output fd for the GPIO and drives it to initialValue. An existing output handle is
+///     reused; an input handle is closed and the GPIO reopened as an output. The fd stays owned by
+///     the pool and must not be closed by the caller.
+/// </summary>
+/// <param name="gpioId">The GPIO to open.</param>
+/// <param name="initialValue">The level to drive.</param>
+/// <returns>The fd on success, or -1 on failure.</returns>
+int GpioPool_OpenAsOutput(GPIO_Id gpioId, GPIO_Value_Type initialValue);
+
+/// <summary>
+///     Returns an input fd for the GPIO, reusing an existing input handle. The fd stays owned by
+///     the pool and must not be closed by the caller.
+/// </summary>
+/// <param name="gpioId">The GPIO to open.</param>
+/// <returns>The fd on success, or -1 on failure.</returns>
+int GpioPool_OpenAsInput(GPIO_Id gpioId);
+
+/// <summary>
+///     Drives a pooled output, skipping the write when the pool knows the output is already at that
+///     level. Writes made directly with GPIO_SetValue are not seen by the pool.
+/// </summary>
+/// <returns>0 on success, or -1 on failure.</returns>
+int GpioPool_SetValue(GPIO_Id gpioId, GPIO_Value_Type value);
+
+/// <summary>
+///     Reads a pooled GPIO.
+/// </summary>
+/// <returns>0 on success, or -1 on failure.</returns>
+int GpioPool_GetValue(GPIO_Id gpioId, GPIO_Value_Type *outValue);
+
+/// <summary>
+///     Returns the direction the GPIO is currently open in.
+/// </summary>
+GpioPool_Direction GpioPool_GetDirection(GPIO_Id gpioId);
+
+/// <summary>
+///     Closes the GPIO if the pool holds it, e.g. so its pin can be used by a UART.
+/// </summary>
+void GpioPool_Release(GPIO_Id gpioId);
+
+/// <summary>
+///     Closes every GPIO held by the pool.
+/// </summary>
+void GpioPool_CloseAll(void);
+
+/// <summary>
+///     Copies the counters gathered since the last call to GpioPool_LogStats.
+/// </summary>
+void GpioPool_GetStats(GpioPool_Stats *outStats);
+
+/// <summary>
+///     Logs the opens and closes made, and saved, since the last call, then resets the counters.
+/// </summary>
+void GpioPool_LogStats(void);
@@ -3,6 +3,8 @@
 #include <applibs/log.h>
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <time.h>
@@ -12,6 +14,12 @@
 
 #include "platform.h"
 #include "gpio_tests.h"
+#include "gpio_pool.h"
+#include "test_registry.h"
+#include "latency_stats.h"
+#include "gpio_capture.h"
+#include "button_utility.h"
+#include "binlog.h"
 
 // applibs_versions.h defines the API struct versions to use for applibs APIs.
 #include "applibs_versions.h"
@@ -20,42 +28,326 @@
 // Termination state
 extern sig_atomic_t terminationRequired;
 
+// Index in gpioPairs[] of the first pair that failed in this run, or -1
+static int firstFailedPair = -1;
+
 // Determine how many GPIO pairs we have to test
 static const int numGPIOPairs = sizeof(gpioPairs) / (sizeof(GPIO_Id) * 2);
 
 static const int numGPIOTestLevels = sizeof(gpioTestLevels) / sizeof(GPIO_Value_Type);
 
-static int gpioOutputFd = -1;
-static int gpioInputFd = -1;
+#ifdef GPIO_TEST_BATCHED
+// The batched test tracks one bit per pair, so a batch holds at most 64 pairs
+#define MAX_PAIRS_PER_BATCH 64
 
-bool GPIOTestPassed(void) {
+// Pair indices of the batch under test
+static int batchPairs[MAX_PAIRS_PER_BATCH];
 
-	// Sleep so we can see the testing LED color (white)
-	sleep(1);
+// Pairs already assigned to a batch
+static bool pairBatched[sizeof(gpioPairs) / sizeof(GPIO_PAIRS) + 1];
+#endif
 
-	bool allTestsPassed = true;
-	bool testsPassed = true;
+// Settle time of each pair in nanoseconds, from its measured latency: [pair][0] for gpioX driving gpioY, [pair][1]
+// for the reverse.  An input that does not match yet is read again until this long after the write.  Zero until the
+// pair has been characterized, which makes the test read the input once, straight after the write.
+static uint32_t pairSettleNs[sizeof(gpioPairs) / sizeof(GPIO_PAIRS) + 1][2];
+
+#ifdef GPIO_TEST_BATCHED
+static bool GPIOTestBatched(void);
+#else
+static bool GPIOTestSequential(void);
+#endif
+#ifdef GPIO_LATENCY_CHARACTERIZE
+static void GPIOCharacterizeLatency(void);
+#endif
+
+/// <summary>
+///     Returns the nanoseconds since the given time.
+/// </summary>
+static uint64_t nsSince(const struct timespec *start) {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)((now.tv_sec - start->tv_sec) * 1000000000ll + (now.tv_nsec - start->tv_nsec));
+}
+
+/// <summary>
+///     Returns the measured settle time for outputGPIO driving inputGPIO, or 0 if the pair has not been characterized.
+/// </summary>
+static uint32_t settleTimeNs(GPIO_Id outputGPIO, GPIO_Id inputGPIO) {
+
+	for (int i = 0; i < numGPIOPairs; i++) {
+		if (gpioPairs[i].gpioX == outputGPIO && gpioPairs[i].gpioY == inputGPIO) {
+			return pairSettleNs[i][0];
+		}
+		if (gpioPairs[i].gpioY == outputGPIO && gpioPairs[i].gpioX == inputGPIO) {
+			return pairSettleNs[i][1];
+		}
+	}
+	return 0;
+}
+
+bool GPIOTestPassed(void) {
 
 	if (numGPIOPairs == 0) {
-		return allTestsPassed;
+		return true;
 	}
 
-	// Iterate over the GPIO array and for each pair set one as input and the other as output
+#ifdef GPIO_LATENCY_CHARACTERIZE
+	// Measure the settle time of every pair once; later runs allow each pair that long to follow
+	static bool characterized = false;
+	if (!characterized) {
+		GPIOCharacterizeLatency();
+		BinLog_Flush();
+		characterized = true;
+	}
+#endif
+
+	firstFailedPair = -1;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+#ifdef GPIO_TEST_BATCHED
+	bool allTestsPassed = GPIOTestBatched();
+#else
+	bool allTestsPassed = GPIOTestSequential();
+#endif
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	// The pairs log to the binary log while they are timed; format those messages now the timing is done
+	BinLog_Flush();
+	Log_Debug("TEST INFO: GPIO loopback test of %d pairs took %ld us\n", numGPIOPairs,
+		(long)((end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000));
+
+	return allTestsPassed;
+}
+
+#ifndef GPIO_TEST_BATCHED
+
+/// <summary>
+///     Tests the pairs one at a time, opening and closing each pair for each direction.
+/// </summary>
+static bool GPIOTestSequential(void) {
+
+	bool allTestsPassed = true;
+	bool testsPassed = true;
+
+	// Iterate over the GPIO array and for each pair set one as input and the other as output.  Start with the
+	// direction the GPIO pool already holds from the last run, which saves reopening the pair.
 	for (int i = 0; i < numGPIOPairs; i++) {
-		testsPassed = test_GPIO_Pairs(gpioPairs[i].gpioX, gpioPairs[i].gpioY);
+		GPIO_Id first = gpioPairs[i].gpioX;
+		GPIO_Id second = gpioPairs[i].gpioY;
+		if (GpioPool_GetDirection(second) == GpioPool_Direction_Output) {
+			first = gpioPairs[i].gpioY;
+			second = gpioPairs[i].gpioX;
+		}
+
+		testsPassed = test_GPIO_Pairs(first, second);
 		if (!testsPassed) {
 			allTestsPassed = false;
 		}
 		// Swap the GPIO pairs to test the opposite direction
-		testsPassed = test_GPIO_Pairs(gpioPairs[i].gpioY, gpioPairs[i].gpioX);
+		testsPassed = test_GPIO_Pairs(second, first) && testsPassed;
 		if (!testsPassed) {
 			allTestsPassed = false;
+			if (firstFailedPair < 0) {
+				firstFailedPair = i;
+			}
 		}
 	}
 
 	return allTestsPassed;
 }
 
+#else // GPIO_TEST_BATCHED
+
+/// <summary>
+///     Returns true if either GPIO of the pair is already used by a pair in the current batch.
+/// </summary>
+static bool pairConflictsWithBatch(int pair, int batchSize) {
+
+	for (int i = 0; i < batchSize; i++) {
+		const GPIO_PAIRS *other = &gpioPairs[batchPairs[i]];
+		if (gpioPairs[pair].gpioX == other->gpioX || gpioPairs[pair].gpioX == other->gpioY ||
+			gpioPairs[pair].gpioY == other->gpioX || gpioPairs[pair].gpioY == other->gpioY) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+///     Returns the number of bit-plane steps that give every pair of the batch its own pattern of levels: the
+///     bits needed to number the pairs.
+/// </summary>
+static int batchPlaneCount(int batchSize) {
+
+	int planes = 0;
+	while ((1 << planes) < batchSize) {
+		planes++;
+	}
+	return planes;
+}
+
+/// <summary>
+///     Returns the levels the outputs of the batch drive at a step, bit i high for pair i.  The first steps are
+///     gpioTestLevels[] driven on every output.  Then, for each bit plane k, pair i drives bit k of its index and
+///     then its complement; plane 0 alternates the levels across neighbouring pairs.  No two pairs drive the same
+///     levels through the plane steps, so swapped or shorted pairs read the wrong level in at least one of them.
+/// </summary>
+static uint64_t batchStepLevels(int step, int batchSize, uint64_t batchMask) {
+
+	if (step < numGPIOTestLevels) {
+		return (gpioTestLevels[step] == GPIO_Value_High) ? batchMask : 0;
+	}
+
+	int plane = (step - numGPIOTestLevels) / 2;
+	uint64_t levels = 0;
+	for (int i = 0; i < batchSize; i++) {
+		if ((i >> plane) & 1) {
+			levels |= 1ull << i;
+		}
+	}
+	return ((step - numGPIOTestLevels) % 2 == 0) ? levels : (~levels & batchMask);
+}
+
+/// <summary>
+///     Runs every step across the whole batch in one direction.  Each step writes its level to every output
+///     (see batchStepLevels), then all inputs are sampled in one sweep into a bitset that is compared with the
+///     levels written.
+/// </summary>
+/// <param name="batchSize">Number of pairs in the batch</param>
+/// <param name="reversed">false to drive gpioX and read gpioY, true for the opposite direction</param>
+/// <param name="outPassed">Cleared if any pair reads the wrong level</param>
+/// <returns>false if a GPIO could not be opened, written or read</returns>
+static bool testBatchDirection(int batchSize, bool reversed, bool *outPassed) {
+
+	// Take every input and output of the batch from the GPIO pool for this direction.  Inputs go first so a
+	// GPIO that was driving in the other direction stops driving before its partner starts.
+	for (int i = 0; i < batchSize; i++) {
+		const GPIO_PAIRS *pair = &gpioPairs[batchPairs[i]];
+		if (GpioPool_OpenAsInput(reversed ? pair->gpioX : pair->gpioY) < 0) {
+			return false;
+		}
+	}
+	for (int i = 0; i < batchSize; i++) {
+		const GPIO_PAIRS *pair = &gpioPairs[batchPairs[i]];
+		if (GpioPool_OpenAsOutput(reversed ? pair->gpioY : pair->gpioX, GPIO_Value_High) < 0) {
+			return false;
+		}
+	}
+
+	const uint64_t batchMask = (batchSize == 64) ? ~0ull : ((1ull << batchSize) - 1);
+
+	// Mismatched inputs are read again until the slowest pair of the batch has had time to settle
+	uint32_t batchSettleNs = 0;
+	for (int i = 0; i < batchSize; i++) {
+		uint32_t settleNs = pairSettleNs[batchPairs[i]][reversed ? 1 : 0];
+		if (settleNs > batchSettleNs) {
+			batchSettleNs = settleNs;
+		}
+	}
+
+	const int numSteps = numGPIOTestLevels + 2 * batchPlaneCount(batchSize);
+
+	for (int y = 0; y < numSteps; y++) {
+
+		uint64_t expected = batchStepLevels(y, batchSize, batchMask);
+
+		struct timespec written;
+		for (int i = 0; i < batchSize; i++) {
+			const GPIO_PAIRS *pair = &gpioPairs[batchPairs[i]];
+			GPIO_Value_Type level = ((expected >> i) & 1) ? GPIO_Value_High : GPIO_Value_Low;
+			if (GpioPool_SetValue(reversed ? pair->gpioY : pair->gpioX, level) != 0) {
+				Log_Debug("ERROR: Could not set GPIO output value %d: %s (%d).\n", level, strerror(errno), errno);
+				return false;
+			}
+			if (i == batchSize - 1) {
+				clock_gettime(CLOCK_MONOTONIC, &written);
+			}
+		}
+
+		uint64_t observed;
+		do {
+			observed = 0;
+			for (int i = 0; i < batchSize; i++) {
+				const GPIO_PAIRS *pair = &gpioPairs[batchPairs[i]];
+				GPIO_Value_Type value;
+				if (GpioPool_GetValue(reversed ? pair->gpioX : pair->gpioY, &value) != 0) {
+					Log_Debug("TEST FAILURE: Could not read GPIO state: %s (%d)\n", strerror(errno), errno);
+					return false;
+				}
+				if (value == GPIO_Value_High) {
+					observed |= 1ull << i;
+				}
+			}
+		} while (observed != expected && nsSince(&written) < batchSettleNs);
+
+		uint64_t mismatched = observed ^ expected;
+		if (mismatched == 0) {
+			continue;
+		}
+
+		*outPassed = false;
+		BINLOG(GPIO_BATCH_MISMATCH, __builtin_popcountll(mismatched), batchSize, y);
+		for (int i = 0; i < batchSize; i++) {
+			if (mismatched & (1ull << i)) {
+				const GPIO_PAIRS *pair = &gpioPairs[batchPairs[i]];
+				if (firstFailedPair < 0 || batchPairs[i] < firstFailedPair) {
+					firstFailedPair = batchPairs[i];
+				}
+				int level = (int)((expected >> i) & 1);
+				BINLOG(GPIO_READ_MISMATCH, !level, reversed ? pair->gpioX : pair->gpioY, level);
+			}
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+///     Tests all pairs at once.  Pairs are grouped into batches in which no GPIO appears twice; each
+///     batch is opened once per direction and every step is driven and checked across the whole
+///     batch in one sweep.
+/// </summary>
+static bool GPIOTestBatched(void) {
+
+	bool allTestsPassed = true;
+
+	memset(pairBatched, 0, sizeof(pairBatched));
+
+	int remaining = numGPIOPairs;
+	while (remaining > 0) {
+
+		// Greedily collect the pairs that do not share a GPIO with the batch so far
+		int batchSize = 0;
+		for (int i = 0; i < numGPIOPairs && batchSize < MAX_PAIRS_PER_BATCH; i++) {
+			if (!pairBatched[i] && !pairConflictsWithBatch(i, batchSize)) {
+				batchPairs[batchSize++] = i;
+				pairBatched[i] = true;
+			}
+		}
+		remaining -= batchSize;
+
+		BINLOG_DEBUG(GPIO_TESTING_BATCH, batchSize);
+
+		// The MT3620 cannot change the direction of an open GPIO, so the pool reopens each GPIO when its direction
+		// changes.  Starting with the direction the pool already holds from the last run saves one reopen per GPIO.
+		bool reversedFirst = GpioPool_GetDirection(gpioPairs[batchPairs[0]].gpioY) == GpioPool_Direction_Output;
+		if (!testBatchDirection(batchSize, reversedFirst, &allTestsPassed) ||
+			!testBatchDirection(batchSize, !reversedFirst, &allTestsPassed)) {
+			terminationRequired = true;
+			return false;
+		}
+	}
+
+	return allTestsPassed;
+}
+
+#endif // GPIO_TEST_BATCHED
+
 bool test_GPIO_Pairs(GPIO_Id outputGPIO, GPIO_Id inputGPIO) {
 
 	bool testsPassed = true;
@@ -63,41 +355,40 @@ bool test_GPIO_Pairs(GPIO_Id outputGPIO, GPIO_Id inputGPIO) {
 	// Define a variable to use when we read the state of the input GPIO
 	static GPIO_Value_Type newGPIOState;
 
-#ifdef  SHOW_DEBUG
-	Log_Debug("TEST INFO: Testing GPIO_%d --> GPIO_%d\n", outputGPIO, inputGPIO);
-#endif
+	BINLOG_DEBUG(GPIO_TESTING_PAIR, outputGPIO, inputGPIO);
 
-	// Open outputGPIO for output
-	gpioOutputFd = GPIO_OpenAsOutput(outputGPIO, GPIO_OutputMode_PushPull, GPIO_Value_High);
-	if (gpioOutputFd < 0) {
-		Log_Debug("ERROR: Could not open GPIO_%d: %s (%d).\n", outputGPIO, strerror(errno), errno);
+	// Take inputGPIO as an input, then outputGPIO as an output, from the GPIO pool.  The handles stay open in the
+	// pool for the next run.
+	if (GpioPool_OpenAsInput(inputGPIO) < 0 ||
+		GpioPool_OpenAsOutput(outputGPIO, GPIO_Value_High) < 0) {
 		terminationRequired = true;
 		return false;
 	}
 
-	// Open inputGPIO for input
-	gpioInputFd = GPIO_OpenAsInput(inputGPIO);
-	if (gpioInputFd < 0) {
-		Log_Debug("ERROR: Could not open GPIO_%d: %s (%d).\n", inputGPIO, strerror(errno), errno);
-		terminationRequired = true;
-		return false;
-	}
+	uint32_t settleNs = settleTimeNs(outputGPIO, inputGPIO);
 
 	// Cycle through all the differnt GPIO levels we want to test
 	for (int y = 0; y < numGPIOTestLevels; y++) {
 
-		int result = GPIO_SetValue(gpioOutputFd, gpioTestLevels[y]);
+		int result = GpioPool_SetValue(outputGPIO, gpioTestLevels[y]);
 		if (result != 0) {
 			Log_Debug("ERROR: Could not set GPIO_%d output value %d: %s (%d).\n", outputGPIO, gpioTestLevels[y], strerror(errno), errno);
 			terminationRequired = true;
 			return false;
 		}
+		struct timespec written;
+		clock_gettime(CLOCK_MONOTONIC, &written);
+
+		// read inputGPIO and validate correct level, reading again until the pair's settle time has passed
+		int readResult;
+		do {
+			readResult = GpioPool_GetValue(inputGPIO, &newGPIOState);
+		} while (readResult == 0 && newGPIOState != gpioTestLevels[y] && nsSince(&written) < settleNs);
 
-		// read inputGPIO and validate correct level
-		if (GPIO_GetValue(gpioInputFd, &newGPIOState) != -1) {
+		if (readResult != -1) {
 			if (newGPIOState != gpioTestLevels[y]) {
 				testsPassed = false;
-				Log_Debug("TEST FAILURE: Validation Failed!  Read %d from GPIO_%d, expected %d\n", newGPIOState, inputGPIO, gpioTestLevels[y]);
+				BINLOG(GPIO_READ_MISMATCH, newGPIOState, inputGPIO, gpioTestLevels[y]);
 			}
 		}
 		else {
@@ -107,10 +398,295 @@ bool test_GPIO_Pairs(GPIO_Id outputGPIO, GPIO_Id inputGPIO) {
 		}
 	}
 
-	// Close the file descriptors and set them to an invalid value -1
-	CloseFdAndPrintError(gpioOutputFd, "Output GPIO");
-	gpioOutputFd = -1;
-	CloseFdAndPrintError(gpioInputFd, "Input GPIO");
-	gpioInputFd = -1;
 	return testsPassed;
 }
+
+#ifdef GPIO_LATENCY_CHARACTERIZE
+
+// The settle time a pair is allowed is its slowest measured edge times this factor, so an edge a little slower than
+// any seen while characterizing does not fail the pair
+#define GPIO_LATENCY_SETTLE_FACTOR 2
+
+/// <summary>
+///     Toggles outputGPIO GPIO_LATENCY_TOGGLES times and times each edge from the end of the write until inputGPIO
+///     follows, polling the input as fast as it can be read.  Like the loopback test, the time starts once
+///     GPIO_SetValue has returned, so the settle time does not include the write itself.
+/// </summary>
+/// <returns>The slowest edge seen, in nanoseconds, or 0 if any edge was missed or a GPIO failed</returns>
+static uint32_t characterizeDirection(GPIO_Id outputGPIO, GPIO_Id inputGPIO) {
+
+	static LatencyStats stats;
+	LatencyStats_Reset(&stats);
+	int missed = 0;
+
+	if (GpioPool_OpenAsInput(inputGPIO) < 0 || GpioPool_OpenAsOutput(outputGPIO, GPIO_Value_Low) < 0) {
+		return 0;
+	}
+
+	GPIO_Value_Type level = GPIO_Value_Low;
+	for (int toggle = 0; toggle < GPIO_LATENCY_TOGGLES; toggle++) {
+
+		level = (level == GPIO_Value_Low) ? GPIO_Value_High : GPIO_Value_Low;
+		if (GpioPool_SetValue(outputGPIO, level) != 0) {
+			return 0;
+		}
+		struct timespec written;
+		clock_gettime(CLOCK_MONOTONIC, &written);
+
+		GPIO_Value_Type value = !level;
+		uint64_t elapsedNs;
+		do {
+			if (GpioPool_GetValue(inputGPIO, &value) != 0) {
+				return 0;
+			}
+			elapsedNs = nsSince(&written);
+		} while (value != level && elapsedNs < GPIO_LATENCY_TIMEOUT_US * 1000ull);
+
+		if (value == level) {
+			LatencyStats_Add(&stats, elapsedNs);
+		}
+		else {
+			missed++;
+		}
+	}
+
+	char label[48];
+	snprintf(label, sizeof(label), "GPIO LATENCY: GPIO_%d --> GPIO_%d", outputGPIO, inputGPIO);
+	LatencyStats_Log(&stats, label);
+	if (missed > 0) {
+		BINLOG(GPIO_LATENCY_MISSED, outputGPIO, inputGPIO, missed, GPIO_LATENCY_TOGGLES, GPIO_LATENCY_TIMEOUT_US);
+		return 0;
+	}
+	return (uint32_t)stats.maxNs;
+}
+
+/// <summary>
+///     Measures the propagation latency of every pair in both directions.  The loopback test then allows each pair
+///     GPIO_LATENCY_SETTLE_FACTOR times its slowest edge to settle before failing it.
+/// </summary>
+static void GPIOCharacterizeLatency(void) {
+
+	Log_Debug("GPIO LATENCY: timing %d edges per pair and direction\n", GPIO_LATENCY_TOGGLES);
+	for (int i = 0; i < numGPIOPairs && !terminationRequired; i++) {
+		pairSettleNs[i][0] = characterizeDirection(gpioPairs[i].gpioX, gpioPairs[i].gpioY) * GPIO_LATENCY_SETTLE_FACTOR;
+		pairSettleNs[i][1] = characterizeDirection(gpioPairs[i].gpioY, gpioPairs[i].gpioX) * GPIO_LATENCY_SETTLE_FACTOR;
+	}
+}
+
+#endif // GPIO_LATENCY_CHARACTERIZE
+
+#ifdef GPIO_TOGGLE_BENCHMARK
+
+static const int numToggleBenchPins = sizeof(gpioTestList) / sizeof(GPIO_Id);
+
+/// <summary>
+///     Returns the loopback partner of the GPIO in gpioPairs[], or -1 if it has none.
+/// </summary>
+static GPIO_Id loopbackPartner(GPIO_Id gpio) {
+
+	for (int i = 0; i < numGPIOPairs; i++) {
+		if (gpioPairs[i].gpioX == gpio) {
+			return gpioPairs[i].gpioY;
+		}
+		if (gpioPairs[i].gpioY == gpio) {
+			return gpioPairs[i].gpioX;
+		}
+	}
+	return -1;
+}
+
+/// <summary>
+///     Toggles one output as fast as GPIO_SetValue allows for GPIO_TOGGLE_WINDOW_MS and logs its table row.  The
+///     timed window only writes.  If the pin has a loopback partner, GPIO_TOGGLE_EDGE_CHECKS more toggles follow with
+///     the partner read after every write to check the edge arrived.
+/// </summary>
+/// <returns>false if a GPIO could not be opened, written or read, or an edge was missed</returns>
+static bool benchmarkTogglePin(GPIO_Id gpio) {
+
+	static LatencyStats callStats;
+	LatencyStats_Reset(&callStats);
+
+	GPIO_Id partner = loopbackPartner(gpio);
+	uint32_t settleNs = (partner >= 0) ? settleTimeNs(gpio, partner) : 0;
+	if (partner >= 0 && GpioPool_OpenAsInput(partner) < 0) {
+		return false;
+	}
+
+	// Start high (LEDs off) and write through the fd directly so the pool adds no work per call.  An even number of
+	// toggles leaves the pin high again, which keeps the pool's idea of the level right.
+	int fd = GpioPool_OpenAsOutput(gpio, GPIO_Value_High);
+	if (fd < 0) {
+		return false;
+	}
+
+	GPIO_Value_Type level = GPIO_Value_High;
+	uint32_t toggles = 0;
+	struct timespec windowStart;
+	clock_gettime(CLOCK_MONOTONIC, &windowStart);
+	uint64_t windowNs = (uint64_t)GPIO_TOGGLE_WINDOW_MS * 1000000u;
+
+	while ((toggles & 1) != 0 || nsSince(&windowStart) < windowNs) {
+
+		level = (level == GPIO_Value_High) ? GPIO_Value_Low : GPIO_Value_High;
+		struct timespec callStart;
+		clock_gettime(CLOCK_MONOTONIC, &callStart);
+		if (GPIO_SetValue(fd, level) != 0) {
+			Log_Debug("ERROR: Could not set GPIO_%d: %s (%d).\n", gpio, strerror(errno), errno);
+			return false;
+		}
+		LatencyStats_Add(&callStats, nsSince(&callStart));
+		toggles++;
+	}
+	double seconds = (double)nsSince(&windowStart) / 1e9;
+
+	// Check the edges in a pass of their own, so waiting for the partner does not slow the timed toggling
+	uint32_t edgeChecks = 0;
+	uint32_t missedEdges = 0;
+	while (partner >= 0 && ((edgeChecks & 1) != 0 || edgeChecks < GPIO_TOGGLE_EDGE_CHECKS)) {
+
+		level = (level == GPIO_Value_High) ? GPIO_Value_Low : GPIO_Value_High;
+		struct timespec writeEnd;
+		if (GPIO_SetValue(fd, level) != 0) {
+			Log_Debug("ERROR: Could not set GPIO_%d: %s (%d).\n", gpio, strerror(errno), errno);
+			return false;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &writeEnd);
+		edgeChecks++;
+
+		GPIO_Value_Type value;
+		int result;
+		do {
+			result = GpioPool_GetValue(partner, &value);
+		} while (result == 0 && value != level && nsSince(&writeEnd) < settleNs);
+		if (result != 0) {
+			return false;
+		}
+		if (value != level) {
+			missedEdges++;
+		}
+	}
+
+	char edges[48];
+	if (partner >= 0) {
+		snprintf(edges, sizeof(edges), "%u/%u (GPIO_%d)", edgeChecks - missedEdges, edgeChecks, partner);
+	}
+	else {
+		snprintf(edges, sizeof(edges), "-");
+	}
+	Log_Debug("GPIO TOGGLE: GPIO_%-3d %8u %10.0f %8.1f %8.1f %8.1f  %s\n", gpio, toggles, toggles / seconds,
+		(double)LatencyStats_Percentile(&callStats, 50) / 1000.0, (double)LatencyStats_Percentile(&callStats, 99) / 1000.0,
+		(double)callStats.maxNs / 1000.0, edges);
+
+	return missedEdges == 0;
+}
+
+/// <summary>
+///     Benchmarks the toggle rate of every GPIO in gpioTestList[].
+/// </summary>
+static bool GPIOToggleBenchmark(void) {
+
+	bool allEdgesSeen = true;
+
+	Log_Debug("GPIO TOGGLE: %d ms per pin; call latency in us\n", GPIO_TOGGLE_WINDOW_MS);
+	Log_Debug("GPIO TOGGLE: pin      toggles  toggles/s      p50      p99      max  edges seen\n");
+	for (int i = 0; i < numToggleBenchPins && !terminationRequired; i++) {
+		if (!benchmarkTogglePin(gpioTestList[i])) {
+			allEdgesSeen = false;
+		}
+	}
+	return allEdgesSeen;
+}
+
+static bool gpioToggleBenchStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor gpioToggleBenchDescriptor = { .name = "gpio_toggle_bench",
+	.expectedMs = (uint32_t)(sizeof(gpioTestList) / sizeof(GPIO_Id) * GPIO_TOGGLE_WINDOW_MS), .start = &gpioToggleBenchStart,
+	.category = TestCategory_Gpio, .blocking = true };
+
+/// <summary>
+///     Registry entry point.  The benchmark toggles each pin as fast as it can and runs to completion before
+///     returning, so it is blocking and the scheduler runs it alone.
+/// </summary>
+static bool gpioToggleBenchStart(int epollFd, TestDoneHandler doneHandler) {
+
+	doneHandler(&gpioToggleBenchDescriptor, GPIOToggleBenchmark());
+	return true;
+}
+
+#endif // GPIO_TOGGLE_BENCHMARK
+
+#ifdef GPIO_CAPTURE
+
+static bool gpioCaptureStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor gpioCaptureDescriptor = { .name = "gpio_capture", .expectedMs = GPIO_CAPTURE_WINDOW_MS,
+	.start = &gpioCaptureStart, .category = TestCategory_Gpio, .blocking = true };
+
+/// <summary>
+///     Registry entry point.  Captures captureGpios[] for GPIO_CAPTURE_WINDOW_MS, then dumps the capture.  Sampling
+///     busy-polls the inputs to keep the sample rate up, so the test is blocking and the scheduler runs it alone.
+/// </summary>
+static bool gpioCaptureStart(int epollFd, TestDoneHandler doneHandler) {
+
+	Log_Debug("Capturing %d GPIOs for %d ms\n", (int)(sizeof(captureGpios) / sizeof(GPIO_Id)), GPIO_CAPTURE_WINDOW_MS);
+	bool passed = GpioCapture_Run(captureGpios, sizeof(captureGpios) / sizeof(GPIO_Id), GPIO_CAPTURE_WINDOW_MS) == 0;
+	if (passed) {
+		GpioCapture_Dump();
+	}
+	doneHandler(&gpioCaptureDescriptor, passed);
+	return true;
+}
+
+#endif // GPIO_CAPTURE
+
+static bool gpioTestStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor gpioTestDescriptor = { .name = "gpio_loopback", .expectedMs = 50, .start = &gpioTestStart,
+	.category = TestCategory_Gpio, .blocking = true };
+
+/// <summary>
+///     Registry entry point.  The loopback test runs to completion before returning, so it is blocking and the
+///     scheduler runs it alone.
+/// </summary>
+static bool gpioTestStart(int epollFd, TestDoneHandler doneHandler) {
+
+	bool passed = GPIOTestPassed();
+	if (!passed && firstFailedPair >= 0) {
+		TestRegistry_SetFailureIndex(&gpioTestDescriptor, firstFailedPair);
+		TestRegistry_SetFailurePins(&gpioTestDescriptor, gpioPairs[firstFailedPair].gpioX, gpioPairs[firstFailedPair].gpioY);
+	}
+	doneHandler(&gpioTestDescriptor, passed);
+	return true;
+}
+
+void gpioTestRegister(void) {
+
+	// The test claims every GPIO of every pair
+	for (int i = 0; i < numGPIOPairs; i++) {
+		TestRegistry_AddPin(&gpioTestDescriptor.resources, gpioPairs[i].gpioX);
+		TestRegistry_AddPin(&gpioTestDescriptor.resources, gpioPairs[i].gpioY);
+	}
+	TestRegistry_Register(&gpioTestDescriptor);
+
+#ifdef GPIO_TOGGLE_BENCHMARK
+	// The benchmark claims each output and its loopback partner
+	for (int i = 0; i < numToggleBenchPins; i++) {
+		TestRegistry_AddPin(&gpioToggleBenchDescriptor.resources, gpioTestList[i]);
+		if (loopbackPartner(gpioTestList[i]) >= 0) {
+			TestRegistry_AddPin(&gpioToggleBenchDescriptor.resources, loopbackPartner(gpioTestList[i]));
+		}
+	}
+	TestRegistry_Register(&gpioToggleBenchDescriptor);
+#endif
+
+#ifdef GPIO_CAPTURE
+	// The capture only reads its GPIOs.  The buttons are shared with the button utility, so only the
+	// other GPIOs are claimed.
+	for (size_t i = 0; i < sizeof(captureGpios) / sizeof(GPIO_Id); i++) {
+		if (ButtonUtility_GetFd(captureGpios[i]) < 0) {
+			TestRegistry_AddPin(&gpioCaptureDescriptor.resources, captureGpios[i]);
+		}
+	}
+	TestRegistry_Register(&gpioCaptureDescriptor);
+#endif
+}
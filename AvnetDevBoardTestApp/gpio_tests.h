@@ -2,3 +2,6 @@
 
 bool GPIOTestPassed(void);
 bool test_GPIO_Pairs(GPIO_Id, GPIO_Id);
+
+// Register the GPIO loopback test with the test registry
+void gpioTestRegister(void);
@@ -0,0 +1,84 @@
+#include <string.h>
+
+#include <applibs/log.h>
+
+#include "latency_stats.h"
+
+/// <summary>
+///     Maps a value to its bucket: exact below 8, then 8 buckets per power of two.
+/// </summary>
+static unsigned BucketIndex(uint64_t ns)
+{
+    if (ns < 8) {
+        return (unsigned)ns;
+    }
+    unsigned exponent = 63u - (unsigned)__builtin_clzll(ns);
+    unsigned index = (exponent - 2) * 8 + (unsigned)((ns >> (exponent - 3)) & 7);
+    return index < LATENCY_STATS_BUCKETS ? index : LATENCY_STATS_BUCKETS - 1;
+}
+
+/// <summary>
+///     Returns the largest value that maps to the bucket.
+/// </summary>
+static uint64_t BucketTop(unsigned index)
+{
+    if (index < 8) {
+        return index;
+    }
+    unsigned exponent = index / 8 + 2;
+    uint64_t sub = index % 8;
+    return ((8 + sub + 1) << (exponent - 3)) - 1;
+}
+
+void LatencyStats_Reset(LatencyStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void LatencyStats_Add(LatencyStats *stats, uint64_t ns)
+{
+    if (stats->count == 0 || ns < stats->minNs) {
+        stats->minNs = ns;
+    }
+    if (ns > stats->maxNs) {
+        stats->maxNs = ns;
+    }
+    stats->count++;
+    stats->totalNs += ns;
+    stats->buckets[BucketIndex(ns)]++;
+}
+
+uint64_t LatencyStats_Percentile(const LatencyStats *stats, unsigned percent)
+{
+    if (stats->count == 0) {
+        return 0;
+    }
+
+    // Rank of the sample, rounded up so p100 is the last sample
+    uint64_t rank = ((uint64_t)stats->count * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LATENCY_STATS_BUCKETS; i++) {
+        seen += stats->buckets[i];
+        if (seen >= rank) {
+            uint64_t top = BucketTop(i);
+            return top < stats->maxNs ? top : stats->maxNs;
+        }
+    }
+    return stats->maxNs;
+}
+
+void LatencyStats_Log(const LatencyStats *stats, const char *label)
+{
+    if (stats->count == 0) {
+        Log_Debug("%s: no samples\n", label);
+        return;
+    }
+    Log_Debug("%s: %u samples, min %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", label,
+              stats->count, (double)stats->minNs / 1000.0,
+              (double)LatencyStats_Percentile(stats, 50) / 1000.0,
+              (double)LatencyStats_Percentile(stats, 99) / 1000.0, (double)stats->maxNs / 1000.0);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+/// <summary>
+///     Number of histogram buckets. Values below 8 ns get a bucket each; above that every power of
+///     two is split into 8 buckets, so a percentile is accurate to within 12.5%.
+/// </summary>
+#define LATENCY_STATS_BUCKETS 256
+
+/// <summary>
+///     Latency histogram in nanoseconds. Zero-initialize or call LatencyStats_Reset before use.
+/// </summary>
+typedef struct {
+    uint32_t count;
+    uint64_t minNs;
+    uint64_t maxNs;
+    uint64_t totalNs;
+    uint32_t buckets[LATENCY_STATS_BUCKETS];
+} LatencyStats;
+
+/// <summary>
+///     Clears the histogram.
+/// </summary>
+void LatencyStats_Reset(LatencyStats *stats);
+
+/// <summary>
+///     Adds one sample.
+/// </summary>
+void LatencyStats_Add(LatencyStats *stats, uint64_t ns);
+
+/// <summary>
+///     Returns the value below which the given percentage (0-100) of the samples fall, rounded up to
+///     the top of its bucket and clamped to the largest sample. Returns 0 if there are no samples.
+/// </summary>
+uint64_t LatencyStats_Percentile(const LatencyStats *stats, unsigned percent);
+
+/// <summary>
+///     Logs count, min, p50, p99 and max in microseconds, prefixed with the given label.
+/// </summary>
+void LatencyStats_Log(const LatencyStats *stats, const char *label);
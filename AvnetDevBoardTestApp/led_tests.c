@@ -12,6 +12,8 @@
 
 #include "platform.h"
 #include "led_tests.h"
+#include "gpio_pool.h"
+#include "test_registry.h"
 
 // applibs_versions.h defines the API struct versions to use for applibs APIs.
 #include "applibs_versions.h"
@@ -24,26 +26,102 @@ extern sig_atomic_t terminationRequired;
 // Calculate how many LEDs we will control
 int static numLedGPIOs = sizeof(gpioTestList) / sizeof(GPIO_Id);
 
-int static fdList[sizeof(gpioTestList) / sizeof(GPIO_Id)];
+// Number of steps in the LED walk, and the index into gpioTestList for each step
+static const int numSeqSteps = sizeof(LedSeqList) / sizeof(GPIO_Id);
+static int seqLedIndex[sizeof(LedSeqList) / sizeof(GPIO_Id)];
+
+// Sequencer state
+static int seqStep = -1;
+static int seqLitIndex = -1;
+static GPIO_Value seqOnLevel = GPIO_Value_Low;
+static void (*seqDoneHandler)(void) = NULL;
+
+static const struct timespec seqStepPeriod = { LED_DELAY_NS / 1000000000, LED_DELAY_NS % 1000000000 };
+static void LedSequenceTimerHandler(wheel_timer_t *timer);
+static wheel_timer_t seqTimer = { .handler = &LedSequenceTimerHandler };
+// Step times that passed while the loop was busy in this walk
+static uint64_t seqLateSteps = 0;
+
+/// <summary>
+///     Drives one LED of the test list.  The GPIO pool skips the write if the LED is already at that level.
+/// </summary>
+static void setLedLevel(int ledIndex, GPIO_Value_Type level) {
+
+	if (ledIndex < 0) {
+		return;
+	}
 
-void cleanupLedFdList(void) {
+	int result = GpioPool_SetValue(gpioTestList[ledIndex], level);
+	if (result != 0) {
+		Log_Debug("TEST FAILURE: Could not set GPIO_%d output value %d: %s (%d).\n", gpioTestList[ledIndex], level, strerror(errno), errno);
+		terminationRequired = true;
+	}
+}
 
-	for (int i = 0; i < numLedGPIOs; i++) {
+/// <summary>
+///     Shows the given step of the walk: the previous LED goes off and this step's LED goes on.
+/// </summary>
+static void showSequenceStep(int step) {
 
-		if (fdList[i] != -1) {
+	int ledIndex = seqLedIndex[step];
+	if (seqLitIndex != ledIndex) {
+		setLedLevel(seqLitIndex, GPIO_Value_High);
+	}
+	setLedLevel(ledIndex, seqOnLevel);
+	seqLitIndex = ledIndex;
+}
 
-			// Turn off all LEDs
-			int result = GPIO_SetValue(fdList[i], GPIO_Value_High);
+/// <summary>
+///     Stops the timer and turns off the LED lit by the current step.
+/// </summary>
+static void stopSequence(void) {
 
-			if (result != 0) {
-				Log_Debug("TEST FAILURE: Could not set GPIO_%d output value %d: %s (%d).\n", gpioTestList[i], GPIO_Value_High, strerror(errno), errno);
-				terminationRequired = true;
-			}
+	StopWheelTimer(&seqTimer);
+	setLedLevel(seqLitIndex, GPIO_Value_High);
+	seqLitIndex = -1;
+	seqStep = -1;
+}
+
+/// <summary>
+///     Handle LED sequencer timer expiry: advance the walk by one step.
+/// </summary>
+static void LedSequenceTimerHandler(wheel_timer_t *timer) {
+
+	if (seqStep < 0) {
+		return;
+	}
 
-			
-			// Close the file descriptors and set them to an invalid value -1
-			CloseFdAndPrintError(fdList[i], "LED GPIO");
-			fdList[i] = -1;
+	// Every LED has to be seen lit, so a late step is still shown, and shown for a full period: the schedule
+	// restarts from now instead of catching up.
+	if (timer->missed > 0) {
+		seqLateSteps += timer->missed;
+		if (StartWheelTimer(timer, &seqStepPeriod, &seqStepPeriod) != 0) {
+			terminationRequired = true;
+		}
+	}
+
+	seqStep++;
+	if (seqStep < numSeqSteps) {
+		showSequenceStep(seqStep);
+		return;
+	}
+
+	if (seqLateSteps > 0) {
+		Log_Debug("INFO: LED walk fell behind by %llu step times; every step was still shown.\n",
+			(unsigned long long)seqLateSteps);
+	}
+	stopSequence();
+	if (seqDoneHandler != NULL) {
+		seqDoneHandler();
+	}
+}
+
+void cleanupLedFdList(void) {
+
+	// Turn off all LEDs that are still held as outputs; the GPIO pool closes the handles at shutdown
+	for (int i = 0; i < numLedGPIOs; i++) {
+		if (GpioPool_GetDirection(gpioTestList[i]) == GpioPool_Direction_Output) {
+			setLedLevel(i, GPIO_Value_High);
 		}
 	}
 }
@@ -57,12 +135,14 @@ bool populateLedFdList(void) {
 		return true;
 	}
 
-	// For each GPIO in the list, create a file descriptor and then turn it on/off 
-
+	// For each GPIO in the list, take an output handle from the GPIO pool, unless it already holds one.  Other
+	// tests may have reopened shared GPIOs as inputs since the last run.
 	for (int i = 0; i < numLedGPIOs; i++) {
 
-		fdList[i] = GPIO_OpenAsOutput(gpioTestList[i], GPIO_OutputMode_PushPull, GPIO_Value_High);
-		if (fdList[i] < 0) {
+		if (GpioPool_GetDirection(gpioTestList[i]) == GpioPool_Direction_Output) {
+			continue;
+		}
+		if (GpioPool_OpenAsOutput(gpioTestList[i], GPIO_Value_High) < 0) {
 			Log_Debug("TEST FAILURE: Could not open GPIO_%d: %s (%d).\n", gpioTestList[i], strerror(errno), errno);
 			returnValue = false;
 			break;
@@ -72,25 +152,92 @@ bool populateLedFdList(void) {
 	return returnValue;
 }
 
-void ledTestChangeLeds(GPIO_Value newState) {
+bool ledTestInitSequencer(void) {
 
-	// Setup ts to ~0.4 seconds
-	struct timespec ts;
-	ts.tv_sec = 0;
-	ts.tv_nsec = LED_DELAY_NS;
+	bool returnValue = true;
 
-	// For each GPIO in the list turn it on/off 
+	// Resolve each step of the walk to its gpioTestList entry once, up front
+	for (int step = 0; step < numSeqSteps; step++) {
+		seqLedIndex[step] = -1;
+		for (int i = 0; i < numLedGPIOs; i++) {
+			if (gpioTestList[i] == LedSeqList[step]) {
+				seqLedIndex[step] = i;
+				break;
+			}
+		}
+		if (seqLedIndex[step] < 0) {
+			Log_Debug("ERROR: LED sequence GPIO_%d is not in gpioTestList, step %d skipped.\n", LedSeqList[step], step);
+			returnValue = false;
+		}
+	}
 
-	for (int i = 0; i < numLedGPIOs; i++) {
+	return returnValue;
+}
 
-		int result = GPIO_SetValue(fdList[i], newState);
-		// pause to turn the LEDs on/off in a sequence
-		nanosleep(&ts, NULL);
-		result = GPIO_SetValue(fdList[i], GPIO_Value_High);
+void ledTestStartSequence(GPIO_Value onLevel, void (*doneHandler)(void)) {
 
-		if (result != 0) {
-			Log_Debug("TEST FAILURE: Could not set GPIO_%d output value %d: %s (%d).\n", gpioTestList[i], newState, strerror(errno), errno);
-			terminationRequired = true;
+	// A walk that is already running is abandoned and restarted from the first step
+	stopSequence();
+
+	seqOnLevel = onLevel;
+	seqDoneHandler = doneHandler;
+
+	if (!populateLedFdList()) {
+		terminationRequired = true;
+	}
+
+	if (numSeqSteps == 0) {
+		if (seqDoneHandler != NULL) {
+			seqDoneHandler();
 		}
+		return;
+	}
+
+	seqStep = 0;
+	seqLateSteps = 0;
+	showSequenceStep(seqStep);
+	if (StartWheelTimer(&seqTimer, &seqStepPeriod, &seqStepPeriod) != 0) {
+		terminationRequired = true;
+	}
+}
+
+void ledTestCloseSequencer(void) {
+
+	stopSequence();
+}
+
+static bool ledTestStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor ledTestDescriptor = { .name = "led_walk", .expectedMs = (uint32_t)(sizeof(LedSeqList) / sizeof(GPIO_Id) * (LED_DELAY_NS / 1000000)),
+	.start = &ledTestStart, .category = TestCategory_Led };
+
+static TestDoneHandler ledRegistryDoneHandler = NULL;
+
+/// <summary>
+///     Passes the end of the walk on to the registry.  The walk needs an operator to check it, so it always passes.
+/// </summary>
+static void ledRegistryDone(void) {
+
+	ledRegistryDoneHandler(&ledTestDescriptor, true);
+}
+
+/// <summary>
+///     Registry entry point.  The walk steps from its timer and reports when the last step is done.
+/// </summary>
+static bool ledTestStart(int epollFd, TestDoneHandler doneHandler) {
+
+	Log_Debug("Now sequencing Click Socket GPIOs, and GPIO27, GPIO29\n");
+	ledRegistryDoneHandler = doneHandler;
+	// The LEDs are wired active low
+	ledTestStartSequence(GPIO_Value_Low, &ledRegistryDone);
+	return true;
+}
+
+void ledTestRegister(void) {
+
+	// The walk claims every GPIO it drives
+	for (int i = 0; i < numLedGPIOs; i++) {
+		TestRegistry_AddPin(&ledTestDescriptor.resources, gpioTestList[i]);
 	}
-}
\ No newline at end of file
+	TestRegistry_Register(&ledTestDescriptor);
+}
@@ -1,5 +1,14 @@
 #pragma once
 
-void ledTestChangeLeds(GPIO_Value);
+// Take output handles for the gpioTestList[] GPIOs from the GPIO pool, and turn the LEDs off again
 bool populateLedFdList(void);
-void cleanupLedFdList(void);
\ No newline at end of file
+void cleanupLedFdList(void);
+
+// LED walk sequencer.  The walk steps through LedSeqList[] from a timer on the timer wheel, so it never blocks
+// the event loop.  Starting a walk while one is running restarts it from the first step.
+bool ledTestInitSequencer(void);
+void ledTestStartSequence(GPIO_Value onLevel, void (*doneHandler)(void));
+void ledTestCloseSequencer(void);
+
+// Register the LED walk with the test registry
+void ledTestRegister(void);
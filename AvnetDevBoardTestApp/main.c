@@ -17,32 +17,48 @@
 
 #include "mt3620_rdb.h"
 #include "rgbled_utility.h"
+#include "button_utility.h"
+#include "gpio_pool.h"
 
 #include "gpio_tests.h"
 #include "uart_tests.h"
 #include "wifi_tests.h"
 #include "led_tests.h"
+#include "test_registry.h"
+#include "blink_code.h"
+#include "binlog.h"
+#include "result_stream.h"
 #include "platform.h"
 
 
 // File descriptors - initialized to invalid value
-static int gpioButton1Fd = -1;
-#ifdef TEST_BUTTON_B
-static int gpioButton2Fd = -1;
-#endif
-static int gpioButtonTimerFd = -1;
-static int gpioLedTimerFd = -1;
 static int epollFd = -1;
 
 // LED state
 static RgbLed led1 = RGBLED_INIT_VALUE;
+#ifdef STATUS_LED_MATRIX
+static RgbLed gpioStatusLed = RGBLED_INIT_VALUE;
+static RgbLed uartStatusLed = RGBLED_INIT_VALUE;
+static RgbLed wifiStatusLed = RGBLED_INIT_VALUE;
+static RgbLed *rgbLeds[] = {&led1, &gpioStatusLed, &uartStatusLed, &wifiStatusLed};
+
+// An array defining the RGB GPIOs for the user LED and the status LEDs
+static const GPIO_Id ledsPins[][3] = { {GPIO_RED, GPIO_GREEN, GPIO_BLUE}, STATUS_LED_GPIO, STATUS_LED_UART,
+	STATUS_LED_WIFI };
+
+// The LED that shows the verdict of each test category
+static const struct {
+	TestCategory category;
+	RgbLed *led;
+} statusLeds[] = { {TestCategory_Led, &led1}, {TestCategory_Gpio, &gpioStatusLed}, {TestCategory_Uart, &uartStatusLed},
+	{TestCategory_Wifi, &wifiStatusLed} };
+#else
 static RgbLed *rgbLeds[] = {&led1};
-static const size_t rgbLedsCount = sizeof(rgbLeds) / sizeof(*rgbLeds);
-
-#include "platform.h"
 
 // An array defining the RGB GPIOs for the user LED
 static const GPIO_Id ledsPins[1][3] = { {GPIO_RED, GPIO_GREEN, GPIO_BLUE} };
+#endif
+static const size_t rgbLedsCount = sizeof(rgbLeds) / sizeof(*rgbLeds);
 
 // Define a variable to control when we run the test(s) again.  This variable is set in the button handler and examined in the main() loop
 static bool runTests = true;
@@ -59,74 +75,118 @@ static void TerminationHandler(int signalNumber)
     terminationRequired = true;
 }
 
+// The buttons that trigger a new test run
+static const GPIO_Id buttonGpios[] = {
+	TEST_BUTTON_A,
+#ifdef TEST_BUTTON_B
+	TEST_BUTTON_B,
+#endif
+};
+
 /// <summary>
-///     Check whether a given button has just been pressed.
+///     Handle a debounced button press: set the flag to run the tests again.
 /// </summary>
-/// <param name="fd">The button file descriptor</param>
-/// <param name="oldState">Old state of the button (pressed or released)</param>
-/// <returns>true if pressed, false otherwise</returns>
-static bool IsButtonPressed(int fd, GPIO_Value_Type *oldState)
+static void ButtonPressedHandler(size_t buttonIndex)
 {
-	bool isButtonPressed = false;
-	GPIO_Value_Type newState;
-	int result = GPIO_GetValue(fd, &newState);
-	if (result != 0) {
-		Log_Debug("ERROR: Could not read button GPIO: %s (%d).\n", strerror(errno), errno);
-		terminationRequired = true;
-	}
-	else {
-		// Button is pressed if it is low and different than last known state.
-		isButtonPressed = (newState != *oldState) && (newState == GPIO_Value_Low);
-		*oldState = newState;
-	}
-
-	return isButtonPressed;
+	runTests = true;
 }
 
+// RGB LED sweep state: the colors shown in turn, one LED_DELAY_NS apart
+static const RgbLedUtility_Colors rgbSweepColors[] = { RgbLedUtility_Colors_Red, RgbLedUtility_Colors_Green,
+	RgbLedUtility_Colors_Blue, RgbLedUtility_Colors_Off };
+static const struct timespec rgbSweepPeriod = { LED_DELAY_NS / 1000000000, LED_DELAY_NS % 1000000000 };
+static size_t rgbSweepStep = 0;
+static TestDoneHandler rgbSweepDoneHandler = NULL;
+
+static bool RgbSweepStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor rgbSweepTest = { .name = "rgb_sweep", .expectedMs = 3 * (LED_DELAY_NS / 1000000),
+	.start = &RgbSweepStart, .category = TestCategory_Led, .resources = { .flags = TEST_RESOURCE_RGB_LED } };
 
 /// <summary>
-///     Handle button timer event: if the button is pressed, change the LED blink rate.
+///     Handle RGB sweep timer expiry: show the next color, and finish after turning the LED off.
 /// </summary>
-static void ButtonTimerEventHandler(event_data_t *eventData)
+static void RgbSweepTimerHandler(wheel_timer_t *timer)
 {
-    if (ConsumeTimerFdEvent(gpioButtonTimerFd) != 0) {
-        terminationRequired = true;
-        return;
-    }
-
-	// If the button is pressed, set the flag to run the tests again.
-	static GPIO_Value_Type newButton1State;
-	if (IsButtonPressed(gpioButton1Fd, &newButton1State)) {
-		runTests = true;
+	rgbSweepStep++;
+	RgbLedUtility_SetLed(&led1, rgbSweepColors[rgbSweepStep]);
+	if (rgbSweepStep + 1 < sizeof(rgbSweepColors) / sizeof(*rgbSweepColors)) {
+		return;
 	}
 
-#ifdef TEST_BUTTON_B
-	// If the button is pressed, set the flag to run the tests again.
-	static GPIO_Value_Type newButton2State;
-	if (IsButtonPressed(gpioButton2Fd, &newButton2State)) {
-		runTests = true;
-	}
-#endif
+	StopWheelTimer(timer);
+	rgbSweepDoneHandler(&rgbSweepTest, true);
 }
 
-// event handler data structures. Only the event handler field needs to be populated.
-static event_data_t buttonEventData = { .eventHandler = &ButtonTimerEventHandler };
+static wheel_timer_t rgbSweepTimer = { .handler = &RgbSweepTimerHandler };
+
+/// <summary>
+///     Registry entry point for the RGB LED sweep: show the first color and step through the rest from a timer.
+/// </summary>
+static bool RgbSweepStart(int epollFd, TestDoneHandler doneHandler)
+{
+	Log_Debug("Now sequencing RGB LEDs\n");
+	rgbSweepDoneHandler = doneHandler;
+	rgbSweepStep = 0;
+	RgbLedUtility_SetLed(&led1, rgbSweepColors[rgbSweepStep]);
+	return StartWheelTimer(&rgbSweepTimer, &rgbSweepPeriod, &rgbSweepPeriod) == 0;
+}
 
 /// <summary>
-///     Helper function to open a file descriptor for the given GPIO as input mode.
+///     Handle the end of a test run: light the RGB LED with the overall result and report the test timings.
 /// </summary>
-/// <param name="gpioId">The GPIO to open.</param>
-/// <param name="outGpioFd">File descriptor of the opened GPIO.</param>
-/// <returns>True if successful, false if an error occurred.</return>
-static bool OpenGpioFdAsInput(GPIO_Id gpioId, int *outGpioFd)
+static void TestRunDoneHandler(bool allPassed)
 {
-	*outGpioFd = GPIO_OpenAsInput(gpioId);
-	if (*outGpioFd < 0) {
-		Log_Debug("ERROR: Could not open GPIO '%d': %d (%s).\n", gpioId, errno, strerror(errno));
-		return false;
+#ifdef STATUS_LED_MATRIX
+	// Show each category's verdict on its own LED, all in one update.  The LED test may have driven the status
+	// LED pins, so the utility's idea of what they show is stale.
+	RgbLedUtility_Update updates[sizeof(statusLeds) / sizeof(*statusLeds)];
+	for (size_t i = 0; i < sizeof(statusLeds) / sizeof(*statusLeds); i++) {
+		TestRegistry_Verdict verdict = TestRegistry_GetCategoryVerdict(statusLeds[i].category);
+		updates[i].led = statusLeds[i].led;
+		updates[i].color = (verdict == TestRegistry_Verdict_Passed) ? RgbLedUtility_Colors_Green
+			: (verdict == TestRegistry_Verdict_Failed) ? RgbLedUtility_Colors_Red : RgbLedUtility_Colors_Off;
+	}
+	RgbLedUtility_ForgetState();
+	RgbLedUtility_SetLeds(updates, sizeof(updates) / sizeof(*updates));
+#endif
+
+	if (allPassed)
+	{
+#ifndef STATUS_LED_MATRIX
+		// Set the LED to Green if tests all passed
+		RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Green);
+#endif
+		Log_Debug("TEST INFO: All tests passed!\n");
+	}
+	else
+	{
+#if defined(FAILURE_BLINK_CODE)
+		// Blink the category and item of the first failure, on the category's LED when there is one per category
+		TestCategory category = TestCategory_Other;
+		int index = -1;
+		TestRegistry_GetFirstFailure(&category, &index);
+		const RgbLed *led = &led1;
+#ifdef STATUS_LED_MATRIX
+		for (size_t i = 0; i < sizeof(statusLeds) / sizeof(*statusLeds); i++) {
+			if (statusLeds[i].category == category) {
+				led = statusLeds[i].led;
+			}
+		}
+#endif
+		BlinkCode_ShowFailure(led, category, index);
+#elif !defined(STATUS_LED_MATRIX)
+		// Test Failed, turn the LED red
+		RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Red);
+#endif
+		Log_Debug("TEST FAILURE: At least one test Failed!  See debug output for details\n");
 	}
 
-	return true;
+	TestRegistry_LogTimings();
+
+#ifdef RESULT_STREAM
+	ResultStream_SendRun(allPassed);
+#endif
 }
 
 /// <summary>
@@ -145,24 +205,9 @@ static int InitPeripheralsAndHandlers(void)
         return -1;
     }
 
-	// Open button A
-	Log_Debug("INFO: Opening MT3620_RDB_BUTTON_A.\n");
-	if (!OpenGpioFdAsInput(TEST_BUTTON_A, &gpioButton1Fd)) {
-		return -1;
-	}
-
-#ifdef TEST_BUTTON_B
-	// Open button B
-	Log_Debug("INFO: Opening MT3620_RDB_BUTTON_B.\n");
-	if (!OpenGpioFdAsInput(TEST_BUTTON_B, &gpioButton2Fd)) {
-		return -1;
-	}
-#endif		
-	// Set up a timer for buttons status check
-	static struct timespec buttonsPressCheckPeriod = { 0, 1000000 };
-	gpioButtonTimerFd =
-		CreateTimerFdAndAddToEpoll(epollFd, &buttonsPressCheckPeriod, &buttonEventData, EPOLLIN);
-	if (gpioButtonTimerFd < 0) {
+	// Open the buttons and start sampling them
+	if (ButtonUtility_Init(epollFd, buttonGpios, sizeof(buttonGpios) / sizeof(*buttonGpios),
+						   &ButtonPressedHandler) != 0) {
 		return -1;
 	}
 
@@ -173,11 +218,51 @@ static int InitPeripheralsAndHandlers(void)
 	// Turn the LED off at startup
 	RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Off);
 
+	// Set up the timer wheel that steps the failure codes, the LED sequences and the coroutine delays
+	if (CreateTimerWheel(epollFd) != 0) {
+		return -1;
+	}
+
 	// Call the routine to populate the file descriptor list to drive all the LEDs for the LED test
 	if (!populateLedFdList()) {
 		terminationRequired = true;
 	}
 
+	// Set up the timer driven LED walk
+	if (!ledTestInitSequencer()) {
+		terminationRequired = true;
+	}
+
+	// Set up the wifi connection check timer
+	if (!wifiTestInit(epollFd)) {
+		terminationRequired = true;
+	}
+
+	// Register the tests.  Each run colors them into groups that share no pins or other resources and runs the
+	// tests of a group at the same time, so the wifi connect and the LED sequences run in the background while the
+	// UART loopback runs.  Blocking tests such as the GPIO loopback run in groups of their own.  The buttons are
+	// sampled throughout, so their pins are reserved.
+	TestRegistry_Init(epollFd);
+	TestResources buttonPins = { { 0, 0 }, 0 };
+	for (size_t i = 0; i < sizeof(buttonGpios) / sizeof(*buttonGpios); i++) {
+		TestRegistry_AddPin(&buttonPins, buttonGpios[i]);
+	}
+#ifdef RESULT_STREAM
+	// Send the results on a UART of their own; its pins are held for the whole run like the buttons
+	if (ResultStream_Init(epollFd, RESULT_STREAM_UART, RESULT_STREAM_BAUD) != 0) {
+		return -1;
+	}
+	TestRegistry_AddUartPins(&buttonPins, RESULT_STREAM_UART - MT3620_UART_ISU0);
+	TestRegistry_Reserve("buttons and result stream", &buttonPins);
+#else
+	TestRegistry_Reserve("buttons", &buttonPins);
+#endif
+	wifiTestRegister();
+	TestRegistry_Register(&rgbSweepTest);
+	ledTestRegister();
+	gpioTestRegister();
+	uartTestRegister();
+
 	return 0;
 }
 
@@ -186,82 +271,75 @@ static int InitPeripheralsAndHandlers(void)
 /// </summary>
 static void ClosePeripheralsAndHandlers(void)
 {
-	// Turn off the LEDs in the LED test
-	ledTestChangeLeds(GPIO_Value_High);
+	// Stop the wifi and UART tests, the RGB sweep and the LED walk, and turn off the LEDs in the LED test
+	wifiTestClose();
+	uartTestClose();
+	StopWheelTimer(&rgbSweepTimer);
+	ledTestCloseSequencer();
 	cleanupLedFdList();
+	BlinkCode_Close();
+	CloseTimerWheel();
+#ifdef RESULT_STREAM
+	ResultStream_LogStats();
+	ResultStream_Close();
+#endif
 
     // Leave the LED off
 	RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Off);
 
     Log_Debug("Closing file descriptors.\n");
-    CloseFdAndPrintError(gpioLedTimerFd, "LedTimer");
-    CloseFdAndPrintError(gpioButtonTimerFd, "ButtonTimer");
-    CloseFdAndPrintError(gpioButton1Fd, "GpioButton1");
-#ifdef TEST_BUTTON_B
-	CloseFdAndPrintError(gpioButton2Fd, "GpioButton2");
-#endif	
+    ButtonUtility_Close();
 	CloseFdAndPrintError(epollFd, "Epoll");
 
 	// Close the LEDs and leave then off
 	RgbLedUtility_CloseLeds(rgbLeds, rgbLedsCount);
 
+	// Close every GPIO the tests kept open across runs
+	GpioPool_CloseAll();
+
 }
 
 /// <summary>
 ///     Main entry point for this application.
 /// </summary>
 int main(int argc, char *argv[])
-
 {
-// Setup ts to ~0.4 seconds //pf
-struct timespec ts;
-ts.tv_sec = 0;
-ts.tv_nsec = LED_DELAY_NS;
-
     Log_Debug("Avnet Development Board Test application starting.\n");
     if (InitPeripheralsAndHandlers() != 0) {
         terminationRequired = true;
     }
 
-	GPIO_Value newLEDState = GPIO_Value_Low;
-
     // Use epoll to wait for events and trigger handlers, until an error or SIGTERM happens
     while (!terminationRequired) {
 
-		if (runTests) 
+		// A button press during a run starts another run once this one has finished
+		if (runTests && !TestRegistry_Running())
 		{
-			Log_Debug("Now sequencing RGB LEDs\n");
-			// Sequence RGB LEDs then turn RGB off...
-			RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Red); 	nanosleep(&ts, NULL);
-			RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Green); nanosleep(&ts, NULL);
-			RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Blue); nanosleep(&ts, NULL);
-			RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Off);
-
-			// Call the routine that implements the Click-Socket LED test.
-			Log_Debug("Now sequencing Click Socket GPIOs, and GPIO27, GPIO29\n");
-			ledTestChangeLeds(newLEDState);
-			newLEDState = (newLEDState == GPIO_Value_Low) ? GPIO_Value_Low : GPIO_Value_High;
-
-			if (1) //pf (GPIOTestPassed() & uartTestsPassed() & wifiTestsPassed())
-			{
-				// Set the LED to Green if tests all passed
-				RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Green);
-				Log_Debug("TEST INFO: All tests passed!\n");
-			}
-			else
-			{
-				// Test Failed, turn the LED red
-				RgbLedUtility_SetLed(&led1, RgbLedUtility_Colors_Red);
-				Log_Debug("TEST FAILURE: At least one test Failed!  See debug output for details\n");
-			}
+			// Report what button monitoring, GPIO handling, LED updates and the event loop have cost since the
+			// last run, including any timer expirations that were missed
+			ButtonUtility_LogStats();
+			GpioPool_LogStats();
+			RgbLedUtility_LogStats();
+			LogEpollDispatchStats();
+			LogEventLoopTelemetry();
+
+			// The RGB sweep needs the LED the last failure code is blinking on
+			BlinkCode_Stop();
+
 			runTests = false;
+			TestRegistry_RunAll(&TestRunDoneHandler);
 		}
 
+		// The loop is about to go idle: format whatever the handlers put in the binary log
+		BinLog_Flush();
+
 		if (WaitForEventAndCallHandler(epollFd) != 0) {
 			terminationRequired = true;
 		}
     }
 
+    BinLog_Flush();
+
     ClosePeripheralsAndHandlers();
     Log_Debug("Application exiting.\n");
     return 0;
@@ -24,6 +24,26 @@ RGB test status --
 		Test passed: Green
 		Test failed: Red
 
+	#define STATUS_LED_MATRIX
+
+		On boards with more than one RGB LED, defining STATUS_LED_MATRIX shows a verdict per test category instead of
+		a single verdict: the RGB LED above shows the LED tests, and the LEDs in STATUS_LED_GPIO, STATUS_LED_UART and
+		STATUS_LED_WIFI show the GPIO, UART and WiFi tests.  Each LED is Green if all tests in its category passed,
+		Red if any failed and off if the category has no tests.  All four LEDs are updated together at the end of
+		each run, so the operator can see which subsystem failed without reading the debug output.  The status LEDs
+		may also be used by the Drive GPIO/LED test; they show the verdicts once the run is over.
+
+	#define FAILURE_BLINK_CODE
+	#define BLINK_CODE_UNIT_MS 250
+
+		When FAILURE_BLINK_CODE is defined, a failed run blinks a code instead of showing steady Red, so a board can
+		be triaged without a debug session.  The code is for the first failed test: its category color for 4 units
+		(GPIO Magenta, UART Cyan, WiFi Blue, LED Yellow), a pause, then the failed item as red blinks of one unit
+		per count, one decimal digit at a time with a single long red blink for a 0.  The item is the index in
+		gpioPairs[] of the first failing pair for the GPIO test and the ISU number for the UART test; tests without
+		an item show the category alone.  The code repeats after a pause until the next run starts.  With
+		STATUS_LED_MATRIX the code blinks on the failing category's LED.  A unit is BLINK_CODE_UNIT_MS.
+
 Button operation --
 
 	There can be 1 or two buttons defined at compile time.  When the application is running pressing any of these
@@ -71,6 +91,49 @@ Button operation --
 
 		This data structure cannot be empty.
 
+	#define GPIO_TEST_BATCHED
+
+		When GPIO_TEST_BATCHED is defined all pairs are tested together: every pair is opened once per direction, each
+		step is written to all outputs and then all inputs are read in one sweep and checked as a bitset.  The steps
+		are the gpioTestLevels[] on every output, then for each bit of the pair numbers a step where each pair drives
+		that bit of its number and a step where it drives the complement, so the pairs drive different levels and a
+		swapped or shorted pair fails.  Pairs that share a GPIO are automatically placed in separate batches.  Comment the define out to test the pairs one at a
+		time as before.  Either way the debug output reports how long the GPIO test took.
+
+	#define GPIO_LATENCY_CHARACTERIZE
+	#define GPIO_LATENCY_TOGGLES 200
+	#define GPIO_LATENCY_TIMEOUT_US 1000
+
+		When GPIO_LATENCY_CHARACTERIZE is defined, the first GPIO test measures how long each pair takes to
+		propagate an edge in each direction.  Each output is toggled GPIO_LATENCY_TOGGLES times.  After each write
+		the input is polled until it follows, up to GPIO_LATENCY_TIMEOUT_US.  The debug output gets min, p50, p99
+		and max for each pair and direction.  Edges are timed from the end of the write, as the loopback test times
+		them.  From then on the loopback test keeps reading an input that does not match yet until twice the slowest
+		edge measured for the pair has passed, which leaves a margin for an edge slower than any seen while
+		characterizing.  Without characterization the input is read once, straight after the write.
+
+	#define GPIO_TOGGLE_BENCHMARK
+	#define GPIO_TOGGLE_WINDOW_MS 100
+	#define GPIO_TOGGLE_EDGE_CHECKS 100
+
+		When GPIO_TOGGLE_BENCHMARK is defined, every run also benchmarks each GPIO in gpioTestList[] (see test 4).
+		Each pin is toggled with GPIO_SetValue as fast as possible for GPIO_TOGGLE_WINDOW_MS; nothing else is done
+		in that window, so the rate is the write rate alone.  If the pin is part of a pair in gpioPairs[], it is then
+		toggled GPIO_TOGGLE_EDGE_CHECKS more times, untimed, with its partner read after every write to check the
+		edge arrived.  The debug output gets one row per pin with the toggles per second, the p50, p99 and max
+		GPIO_SetValue call time, and the edges seen.  The benchmark fails if any edge is missed.  It holds the event
+		loop for the whole sweep, so the scheduler runs it alone rather than beside the background tests.
+
+	#define GPIO_CAPTURE
+	#define GPIO_CAPTURE_WINDOW_MS 2000
+
+		When GPIO_CAPTURE is defined, every run also acts as a simple logic analyzer on the GPIOs in captureGpios[]
+		(the buttons by default, listed at the end of this file).  The inputs are sampled as fast as they can be
+		read for GPIO_CAPTURE_WINDOW_MS and stored as runs of identical samples, so a quiet input costs almost
+		nothing.  Up to GPIO_CAPTURE_MAX_RUNS runs are kept; on overflow the oldest are dropped.  The capture is
+		then written to the debug output as hex lines starting with "CAPTURE: ".  Save the debug output to a file
+		and convert it with HostTools/capture2vcd to view the capture in a waveform viewer such as GTKWave.
+
 2. UART Loopback test
 
 -- Description
@@ -95,6 +158,32 @@ Button operation --
 
 		If this data structure is empty, then the UART test portion of the application will return pass.
 
+		All the UARTs listed are opened and tested at the same time, so the UART test takes as long as the slowest
+		UART.  The debug output reports the time each UART took and the total.
+
+	#define UART_TEST_BAUD_RATE 9600
+	#define UART_DEADLINE_MARGIN_MS 10
+
+		The test string is sent at UART_TEST_BAUD_RATE and compared byte by byte as it arrives, so the test finishes
+		as soon as the last byte matches and reports the first byte that does not.  A UART fails if the string has not
+		arrived by its deadline, which is 1.5 times the time the string takes on the wire plus
+		UART_DEADLINE_MARGIN_MS.
+
+	#define UART_BENCHMARK
+	static const uint32_t uartBenchBaudRates[] = { 9600, 115200, 460800, 921600 };
+	static const size_t uartBenchPayloadSizes[] = { 16, 256, 1024, 4096 };
+
+		When UART_BENCHMARK is defined, each UART in uartIDs[] is also benchmarked.  For every
+		baud rate and payload size combination a PRBS15 pattern is sent over the loopback and the debug output gets a
+		table row with the bytes received, the sustained bytes per second, that rate as a percentage of the line rate
+		(baud / 10 bytes per second), the number of bit errors and the bytes lost and extra.  When a byte is dropped or
+		inserted the received stream is realigned with the pattern, so the slip is counted as lost or extra bytes
+		rather than as bit errors in every byte after it; bit errors are only counted on bytes that line up.  Bytes
+		that never arrive count as lost.  Throughput is timed from the first byte written or received to the last
+		byte received.  Payloads are limited to 4096 bytes.  The benchmark is a test of its own, uart_bench, that
+		always passes.  It uses the same UARTs as the loopback test, so the scheduler runs the two apart, and its
+		expected time is the wire time of the whole sweep plus UART_DEADLINE_MARGIN_MS per transfer.
+
 3. Wifi test
 
 -- Description
@@ -116,6 +205,21 @@ Button operation --
 		strength for the access point defined meets the minimum signal strength threshold.  If not, then the wifi test
 		will fail and the details of the failure will be output in the debug window.
 
+	#define WIFI_CONNECT_TIMEOUT_MS 45000
+	#define WIFI_CONNECT_POLL_MIN_MS 100
+	#define WIFI_CONNECT_POLL_MAX_MS 1000
+
+		The wifi test runs in the background while the other tests run, so a test cycle takes as long as the longer of
+		the two.  The connection is first checked WIFI_CONNECT_POLL_MIN_MS after the network is stored, then at
+		intervals that double up to WIFI_CONNECT_POLL_MAX_MS.  The test fails if the device has not connected within
+		WIFI_CONNECT_TIMEOUT_MS.  The debug output reports the time to connect in milliseconds.
+
+	#define WIFI_SCAN_CACHE_FRESH_MS 10000
+
+		The scan results are kept between runs.  A run that starts less than WIFI_SCAN_CACHE_FRESH_MS after the last
+		scan reuses its results instead of scanning again.  Set it to 0 to scan on every run.  Only the target network
+		is logged; define SHOW_DEBUG to log every network found.
+
 4. Drive GPIO/LED test
 
 -- Description
@@ -141,6 +245,14 @@ Button operation --
 
 		If this data structure is empty, then no LEDs will be driven.
 
+		GPIO_Id LedSeqList[] = { MT3620_RDB_LED2_RED, MT3620_RDB_LED2_GREEN, MT3620_RDB_LED2_BLUE};
+
+		The LedSeqList[] data structure is the frame table for the LED walk.  Each entry is one step of the walk: the
+		GPIO listed is driven to the test level and the GPIO lit by the previous step is turned off.  A GPIO may
+		appear more than once, but every GPIO in LedSeqList[] must also be listed in gpioTestList[].  The walk is
+		stepped from a timer every LED_DELAY_NS, so buttons stay responsive while it runs.  A button press during
+		a run does not interrupt the walk; it starts another run once this one has finished.
+
 5. Test Button Information
 
 -- Description
@@ -161,6 +273,18 @@ Button operation --
 		
 		Note that all the GPIOs associated with the buttons must be enabled in the app_manifest.jston file.
 
+	#define BUTTON_IDLE_POLL_MS 50
+	#define BUTTON_BURST_POLL_MS 1
+	#define BUTTON_BURST_DURATION_MS 100
+	#define BUTTON_DEBOUNCE_MS 20
+
+		The MT3620 does not deliver GPIO interrupts to high-level applications, so the buttons are polled.  They are
+		sampled every BUTTON_IDLE_POLL_MS while idle and every BUTTON_BURST_POLL_MS for BUTTON_BURST_DURATION_MS after
+		an edge.  A press is reported once the button has read low for BUTTON_DEBOUNCE_MS, so a press has to last at
+		least BUTTON_IDLE_POLL_MS + BUTTON_DEBOUNCE_MS to be seen.  Each test run logs the button wakeups per second
+		and the press-to-action latency.  The latency is timed from the sample before the edge was seen, so it
+		includes the up to BUTTON_IDLE_POLL_MS the edge waited for the next poll and is an upper bound.
+
 6. Additional build time defines
 
 	#define RUN_WIFI_TESTS_ONCE true
@@ -176,6 +300,36 @@ Button operation --
 
 		We can turn on additional debug for troubleshooting by defining SHOW_DEBUG.
 
+	#define EPOLL_TELEMETRY
+
+		Defining EPOLL_TELEMETRY times the event loop.  After each run it logs "TELEMETRY:" lines with the time spent
+		waiting, in handlers and outside both (the main loop's own work around the wait, such as starting a run), which
+		add up to the time since the last report, and the wakeups per second, then one line per event with its
+		dispatch count, total and longest handler time and missed timer expirations.  Use it to check what the idle loop costs and to find
+		slow handlers.  Without it the event loop has no timing code at all.
+
+	#define BINLOG_RAW
+
+		Messages logged from the GPIO test loops go to a binary log in RAM (binlog.h) and are formatted when the
+		event loop is idle, so the logging does not slow the loops down.  Defining BINLOG_RAW logs each record as a
+		"BINLOG:" hex line instead of formatting it on the device; HostTools/binlog_decode turns a saved debug log
+		back into text with a timestamp per message.  Messages that only SHOW_DEBUG enables are left out of the build
+		entirely when it is not defined.
+
+	#define RESULT_STREAM
+	#define RESULT_STREAM_UART MT3620_UART_ISU4
+	#define RESULT_STREAM_BAUD 921600
+
+		Defining RESULT_STREAM sends the result of every test after each run as compact binary records on a UART
+		used for nothing else, so a station PC on the production line can collect the verdicts without the debug
+		toolchain.  Each record holds the test, its category, pass/fail, its start offset, duration and expected
+		duration, and the item (GPIO pair or ISU) and GPIOs that failed.  Records are COBS framed with a CRC, see
+		result_stream_protocol.h, and HostTools/result_decode converts the stream to CSV or JSON.  The pins of
+		RESULT_STREAM_UART are reserved: a test that uses any of them fails without running, so pick an ISU that no
+		gpioPairs[], uartIDs[] or LED entry of the board uses.  The default, ISU4 (GPIO 71-74), is free on both
+		boards.  Add the UART to the "Uart": [] section of the app_manifest.json file and remove its pins from the
+		"Gpio": [] section.
+
 */
 
 // Define which development board we are building for
@@ -192,15 +346,70 @@ Button operation --
 // Enables extra debug for troubleshooting
 //#define SHOW_DEBUG
 
+// Uncomment to log wakeups, handler time and missed timer expirations per event after each run
+//#define EPOLL_TELEMETRY
+
+// Uncomment to dump the binary log as hex for HostTools/binlog_decode instead of formatting it on the device
+//#define BINLOG_RAW
+
+// Uncomment to send the test results as binary records on RESULT_STREAM_UART for HostTools/result_decode
+//#define RESULT_STREAM
+#define RESULT_STREAM_UART MT3620_UART_ISU4
+#define RESULT_STREAM_BAUD 921600
+
 // If we only want to run the wifi test once then set this to true.  If it's set to false, then the wifi test will run
 // when the application starts, but will not run again if the operator presses a button.  This can save time since the 
 // wifi tests can take a few seconds.  If the test fails on the first pass and this is set to true, the test will 
 // continue to report fail and output debug saying that wifi failed on the first pass.
 #define RUN_WIFI_TESTS_ONCE true 
 
+// Test all GPIO loopback pairs in one pass: every pair is opened once per direction, each level is driven on all
+// outputs and all inputs are sampled in one sweep.  Comment out to test the pairs one at a time.
+#define GPIO_TEST_BATCHED
+
+// Uncomment to measure each pair's propagation latency on the first run and allow each pair that long to follow
+//#define GPIO_LATENCY_CHARACTERIZE
+#define GPIO_LATENCY_TOGGLES 200
+#define GPIO_LATENCY_TIMEOUT_US 1000
+
+// Uncomment to benchmark how fast each GPIO in gpioTestList[] can be toggled
+//#define GPIO_TOGGLE_BENCHMARK
+#define GPIO_TOGGLE_WINDOW_MS 100
+#define GPIO_TOGGLE_EDGE_CHECKS 100
+
+// Uncomment to capture the GPIOs in captureGpios[] for GPIO_CAPTURE_WINDOW_MS and dump them for HostTools/capture2vcd
+//#define GPIO_CAPTURE
+#define GPIO_CAPTURE_WINDOW_MS 2000
+
+// Uncomment to show the GPIO, UART, WiFi and LED verdicts on separate RGB LEDs (boards with four RGB LEDs only)
+//#define STATUS_LED_MATRIX
+
+// Blink a code for the first failed test instead of showing steady red.  BLINK_CODE_UNIT_MS is the length of one blink.
+#define FAILURE_BLINK_CODE
+#define BLINK_CODE_UNIT_MS 250
+
 // Define how long we want to pause (in nano seconds) between lighting up LEDs in the LED test sequence.
 #define LED_DELAY_NS 400000000
 
+// Button sampling.  The buttons are polled slowly while idle; once an edge is seen they are polled quickly for a
+// short burst so the press is debounced and reported promptly.  A level only counts once it has been stable for
+// BUTTON_DEBOUNCE_MS.
+#define BUTTON_IDLE_POLL_MS 50
+#define BUTTON_BURST_POLL_MS 1
+#define BUTTON_BURST_DURATION_MS 100
+#define BUTTON_DEBOUNCE_MS 20
+
+// UART loopback baud rate and the slack added to the computed receive deadline
+#define UART_TEST_BAUD_RATE 9600
+#define UART_DEADLINE_MARGIN_MS 10
+
+// Uncomment to sweep every UART in uartIDs[] over these baud rates and payload sizes as the uart_bench test
+//#define UART_BENCHMARK
+#ifdef UART_BENCHMARK
+static const uint32_t uartBenchBaudRates[] = { 9600, 115200, 460800, 921600 };
+static const size_t uartBenchPayloadSizes[] = { 16, 256, 1024, 4096 };
+#endif
+
 // Define a structure that defines the pair or GPIOs to test.
 typedef struct {
 	GPIO_Id gpioX;
@@ -221,6 +430,14 @@ static const GPIO_Value_Type gpioTestLevels[] = { GPIO_Value_Low, GPIO_Value_Hig
 //#define WIFI_KEY  "ElliesRun"
 #define MINIMUM_WIFI_SIGNAL_STRENGTH -75.0f
 
+// How long the wifi test waits to connect, and the first and longest intervals between connection checks
+#define WIFI_CONNECT_TIMEOUT_MS 45000
+#define WIFI_CONNECT_POLL_MIN_MS 100
+#define WIFI_CONNECT_POLL_MAX_MS 1000
+
+// Reruns within this many milliseconds of the last wifi scan reuse its results
+#define WIFI_SCAN_CACHE_FRESH_MS 10000
+
 #ifdef SEEED_DEV_BOARD
 
 // For the GPIO only test update the app_manifest.json file with these setting
@@ -275,6 +492,10 @@ static const GPIO_Id gpioTestList[] = { MT3620_RDB_LED2_RED, MT3620_RDB_LED2_GRE
 										MT3620_RDB_LED3_RED, MT3620_RDB_LED3_GREEN, MT3620_RDB_LED3_BLUE,
 										MT3620_RDB_LED4_RED, MT3620_RDB_LED4_GREEN, MT3620_RDB_LED4_BLUE };
 
+static const GPIO_Id LedSeqList[] = { MT3620_RDB_LED2_RED, MT3620_RDB_LED2_GREEN, MT3620_RDB_LED2_BLUE,
+									  MT3620_RDB_LED3_RED, MT3620_RDB_LED3_GREEN, MT3620_RDB_LED3_BLUE,
+									  MT3620_RDB_LED4_RED, MT3620_RDB_LED4_GREEN, MT3620_RDB_LED4_BLUE };
+
 // GPIOs to add to the app_manifest.json file for the LED test
 // 15, 16, 17, 18, 19, 20, 21, 22, 23
 
@@ -286,6 +507,12 @@ static const GPIO_Id gpioTestList[] = { MT3620_RDB_LED2_RED, MT3620_RDB_LED2_GRE
 #define GPIO_GREEN MT3620_RDB_LED1_GREEN
 #define GPIO_BLUE MT3620_RDB_LED1_BLUE
 
+// Define the red, green and blue GPIOs of the RGB LEDs that show the GPIO, UART and WiFi verdicts when
+// STATUS_LED_MATRIX is defined.  The user LED above shows the LED verdict.
+#define STATUS_LED_GPIO { MT3620_RDB_LED2_RED, MT3620_RDB_LED2_GREEN, MT3620_RDB_LED2_BLUE }
+#define STATUS_LED_UART { MT3620_RDB_LED3_RED, MT3620_RDB_LED3_GREEN, MT3620_RDB_LED3_BLUE }
+#define STATUS_LED_WIFI { MT3620_RDB_LED4_RED, MT3620_RDB_LED4_GREEN, MT3620_RDB_LED4_BLUE }
+
 // ================================>>>> Test button defines <<<<=======================================================
 
 // Define the GPIO for the user button
@@ -383,6 +610,11 @@ static const GPIO_Id LedSeqList[] = { MT3620_GPIO42, MT3620_GPIO16, MT3620_GPIO3
 #define GPIO_GREEN MT3620_RDB_LED1_GREEN
 #define GPIO_BLUE MT3620_RDB_LED1_BLUE
 
+// The Avnet board has a single RGB user LED, so the verdicts cannot be split across LEDs
+#ifdef STATUS_LED_MATRIX
+#error "STATUS_LED_MATRIX needs four RGB LEDs, the Avnet board has one"
+#endif
+
 // ================================>>>> Test button defines <<<<=======================================================
 
 // Define the GPIO for the user button
@@ -390,3 +622,19 @@ static const GPIO_Id LedSeqList[] = { MT3620_GPIO42, MT3620_GPIO16, MT3620_GPIO3
 #define GPIO_USER_BUTTON2 MT3620_RDB_BUTTON_B
 
 #endif
+
+
+#ifdef GPIO_CAPTURE
+
+// ==============================>>>> GPIO capture data structures <<<<================================================
+
+// GPIOs sampled by the capture, in the order of their bits in the capture.  Buttons are read through the button
+// utility, any other GPIO is opened as an input.
+static const GPIO_Id captureGpios[] = {
+	TEST_BUTTON_A,
+#ifdef TEST_BUTTON_B
+	TEST_BUTTON_B,
+#endif
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <applibs/log.h>
+
+#include "result_stream.h"
+#include "result_stream_protocol.h"
+#include "epoll_timerfd_utilities.h"
+#include "test_registry.h"
+
+static int streamEpollFd = -1;
+static int streamUartFd = -1;
+static event_data_t streamEventData;
+static bool waitingForSpace = false;
+
+// Transmit ring.  head counts every byte queued and tail every byte written to the UART.
+static uint8_t txBuffer[RESULT_STREAM_TX_SIZE];
+static uint32_t txHead = 0;
+static uint32_t txTail = 0;
+
+// The frames of one run are built here and queued together, so a run is either sent whole or dropped
+static uint8_t runFrames[RESULT_STREAM_TX_SIZE];
+static size_t runLength = 0;
+
+static uint16_t runNumber = 0;
+static uint32_t bytesSent = 0;
+static uint32_t framesSent = 0;
+static uint32_t runsDropped = 0;
+
+/// <summary>
+///     CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xffff, no reflection.
+/// </summary>
+static uint16_t Crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/// <summary>
+///     Appends a record to the run as a frame: the record and its CRC, COBS encoded, then a zero byte.
+///     Each zero is replaced by the distance to the next one, and each run of data starts with that
+///     distance, so the only zero in the frame is the delimiter.
+/// </summary>
+static void AddFrame(const uint8_t *record, size_t length)
+{
+    uint8_t data[RESULT_STREAM_MAX_RECORD + 2];
+    uint8_t frame[RESULT_STREAM_MAX_FRAME];
+
+    memcpy(data, record, length);
+    uint16_t crc = Crc16(record, length);
+    data[length++] = (uint8_t)crc;
+    data[length++] = (uint8_t)(crc >> 8);
+
+    size_t codeIndex = 0;
+    size_t frameLength = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0) {
+            frame[frameLength++] = data[i];
+            code++;
+        }
+        if (data[i] == 0 || code == 0xff) {
+            frame[codeIndex] = code;
+            codeIndex = frameLength++;
+            code = 1;
+        }
+    }
+    frame[codeIndex] = code;
+    frame[frameLength++] = 0;
+
+    if (runLength + frameLength <= sizeof(runFrames)) {
+        memcpy(runFrames + runLength, frame, frameLength);
+    }
+    // An overlong run is detected from runLength when it is queued
+    runLength += frameLength;
+    framesSent++;
+}
+
+static size_t PutU16(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    return 2;
+}
+
+static size_t PutU32(uint8_t *out, uint32_t value)
+{
+    PutU16(out, value);
+    PutU16(out + 2, value >> 16);
+    return 4;
+}
+
+/// <summary>
+///     Writes as much of the ring as the UART accepts, and waits for EPOLLOUT while some is left.
+/// </summary>
+static void Transmit(void)
+{
+    while (txTail != txHead) {
+        size_t offset = txTail & (RESULT_STREAM_TX_SIZE - 1);
+        size_t length = txHead - txTail;
+        if (length > RESULT_STREAM_TX_SIZE - offset) {
+            length = RESULT_STREAM_TX_SIZE - offset;
+        }
+
+        ssize_t written = write(streamUartFd, txBuffer + offset, length);
+        if (written < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+            Log_Debug("ERROR: Could not write the result stream: %s (%d).\n", strerror(errno), errno);
+            txTail = txHead;
+            break;
+        }
+        txTail += (uint32_t)written;
+        bytesSent += (uint32_t)written;
+    }
+
+    bool pending = (txTail != txHead);
+    if (pending != waitingForSpace) {
+        int result = pending ? RegisterEventHandlerToEpoll(streamEpollFd, streamUartFd, &streamEventData, EPOLLOUT)
+                             : UnregisterEventHandlerFromEpoll(streamEpollFd, streamUartFd);
+        if (result == 0) {
+            waitingForSpace = pending;
+        }
+    }
+}
+
+/// <summary>
+///     Handles the UART becoming writable.
+/// </summary>
+static void ResultStreamEventHandler(event_data_t *eventData)
+{
+    (void)eventData;
+    Transmit();
+}
+
+int ResultStream_Init(int epollFd, UART_Id uartId, uint32_t baudRate)
+{
+    UART_Config uartConfig;
+    UART_InitConfig(&uartConfig);
+    uartConfig.baudRate = baudRate;
+    uartConfig.flowControl = UART_FlowControl_None;
+
+    streamUartFd = UART_Open(uartId, &uartConfig);
+    if (streamUartFd < 0) {
+        Log_Debug("ERROR: Could not open the result stream UART: %s (%d).\n", strerror(errno), errno);
+        return -1;
+    }
+
+    streamEpollFd = epollFd;
+    streamEventData.eventHandler = &ResultStreamEventHandler;
+    SetEventTelemetryName(&streamEventData, "ResultStream");
+    return 0;
+}
+
+void ResultStream_SendRun(bool allPassed)
+{
+    if (streamUartFd < 0) {
+        return;
+    }
+
+    uint8_t record[RESULT_STREAM_MAX_RECORD];
+    size_t length;
+    int testCount = TestRegistry_GetTestCount();
+
+    runNumber++;
+    runLength = 0;
+    uint32_t runFramesSent = framesSent;
+
+    TestRegistry_Result result;
+
+    if ((runNumber - 1) % RESULT_STREAM_INFO_INTERVAL == 0) {
+        for (int i = 0; i < testCount; i++) {
+            TestRegistry_GetResult(i, &result);
+            size_t nameLength = strlen(result.test->name);
+            if (nameLength > RESULT_STREAM_MAX_RECORD - 7) {
+                nameLength = RESULT_STREAM_MAX_RECORD - 7;
+            }
+            length = 0;
+            record[length++] = RESULT_STREAM_TEST_INFO;
+            record[length++] = (uint8_t)i;
+            record[length++] = (uint8_t)result.test->category;
+            length += PutU32(record + length, result.test->expectedMs);
+            memcpy(record + length, result.test->name, nameLength);
+            length += nameLength;
+            AddFrame(record, length);
+        }
+    }
+
+    length = 0;
+    record[length++] = RESULT_STREAM_RUN_START;
+    length += PutU16(record + length, runNumber);
+    record[length++] = (uint8_t)testCount;
+    AddFrame(record, length);
+
+    for (int i = 0; i < testCount; i++) {
+        TestRegistry_GetResult(i, &result);
+        length = 0;
+        record[length++] = RESULT_STREAM_TEST_RESULT;
+        record[length++] = (uint8_t)i;
+        record[length++] = (uint8_t)result.verdict;
+        length += PutU16(record + length, (uint16_t)(int16_t)result.failureIndex);
+        for (int pin = 0; pin < 2; pin++) {
+            record[length++] = (result.failurePins[pin] >= 0) ? (uint8_t)result.failurePins[pin] : RESULT_STREAM_NO_PIN;
+        }
+        length += PutU32(record + length, result.startMs);
+        length += PutU32(record + length, result.durationMs);
+        AddFrame(record, length);
+    }
+
+    length = 0;
+    record[length++] = RESULT_STREAM_RUN_END;
+    length += PutU16(record + length, runNumber);
+    record[length++] = allPassed ? 1 : 0;
+    length += PutU32(record + length, TestRegistry_GetRunDurationMs());
+    AddFrame(record, length);
+
+    if (runLength > RESULT_STREAM_TX_SIZE - (txHead - txTail)) {
+        // The station is not reading, or the runs come faster than the baud rate allows
+        runsDropped++;
+        framesSent = runFramesSent;
+        return;
+    }
+    for (size_t i = 0; i < runLength; i++) {
+        txBuffer[(txHead + i) & (RESULT_STREAM_TX_SIZE - 1)] = runFrames[i];
+    }
+    txHead += (uint32_t)runLength;
+
+    Transmit();
+}
+
+void ResultStream_LogStats(void)
+{
+    if (streamUartFd < 0) {
+        return;
+    }
+    Log_Debug("RESULT STREAM: %u runs, %u frames, %u bytes sent, %u runs dropped, %u bytes waiting\n",
+              (unsigned)runNumber, framesSent, bytesSent, runsDropped, txHead - txTail);
+}
+
+void ResultStream_Close(void)
+{
+    if (streamUartFd < 0) {
+        return;
+    }
+    CloseFdAndPrintError(streamUartFd, "ResultStreamUart");
+    streamUartFd = -1;
+    waitingForSpace = false;
+    txTail = txHead;
+}
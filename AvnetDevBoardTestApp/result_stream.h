@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// applibs_versions.h defines the API struct versions to use for applibs APIs.
+#include "applibs_versions.h"
+#include <applibs/uart.h>
+
+/// <summary>
+///     Binary result stream.  After each run the result of every test is written to a dedicated UART as
+///     framed binary records (result_stream_protocol.h), so a station PC can collect the verdicts without
+///     the debug toolchain; HostTools/result_decode turns the stream into CSV or JSON.  Writes never block:
+///     what the UART does not take at once is sent from the event loop, and a run that does not fit in the
+///     transmit buffer is dropped and counted.
+/// </summary>
+
+/// <summary>
+///     Bytes the transmit buffer holds; a power of two.
+/// </summary>
+#define RESULT_STREAM_TX_SIZE 2048
+
+/// <summary>
+///     The name, category and expected duration of each test are sent with the first run and then every
+///     RESULT_STREAM_INFO_INTERVAL runs, so a station that starts listening late learns them soon.
+/// </summary>
+#define RESULT_STREAM_INFO_INTERVAL 16
+
+/// <summary>
+///     Opens the result UART.
+/// </summary>
+/// <param name="epollFd">Epoll instance that drains the transmit buffer</param>
+/// <param name="uartId">UART to send the results on; its pins must not be used by a test</param>
+/// <param name="baudRate">Baud rate of the UART</param>
+/// <returns>0 on success, or -1 on failure</returns>
+int ResultStream_Init(int epollFd, UART_Id uartId, uint32_t baudRate);
+
+/// <summary>
+///     Sends the results of the last run: the test information when it is due, a run start record, the
+///     result of each registered test and a run end record.
+/// </summary>
+void ResultStream_SendRun(bool allPassed);
+
+/// <summary>
+///     Logs the bytes and frames sent and the runs dropped since the UART was opened.
+/// </summary>
+void ResultStream_LogStats(void);
+
+/// <summary>
+///     Closes the result UART.  Bytes that have not been sent yet are discarded.
+/// </summary>
+void ResultStream_Close(void);
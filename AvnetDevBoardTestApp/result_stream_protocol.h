@@ -0,0 +1,24 @@
+#pragma once
+
+// Records of the binary result stream.  A record is a type byte followed by little-endian fields.  It is sent as a
+// frame: the record and its CRC-16/CCITT-FALSE (little-endian) are COBS encoded, so the frame contains no zero byte,
+// and a 0x00 byte ends it.  Record types are only ever added, so a decoder skips types it does not know;
+// HostTools/result_decode.c includes this file to decode the stream.
+
+// u16 run number, u8 number of tests
+#define RESULT_STREAM_RUN_START 0x01
+// u8 test index, u8 TestCategory, u32 expected ms, then the test name without a terminating zero.  What does not change
+// from run to run is sent only now and then, before the run start record.
+#define RESULT_STREAM_TEST_INFO 0x02
+// u8 test index, u8 TestRegistry_Verdict, i16 failure index, u8 failing GPIO A, u8 failing GPIO B, u32 start ms,
+// u32 duration ms; the run is the last run start record
+#define RESULT_STREAM_TEST_RESULT 0x03
+// u16 run number, u8 1 if every test passed, u32 duration ms
+#define RESULT_STREAM_RUN_END 0x04
+
+// Failing GPIO field when there is no pin to report
+#define RESULT_STREAM_NO_PIN 0xff
+
+// Longest record, and the longest frame it encodes to: one COBS overhead byte per 254 bytes, the CRC and the delimiter
+#define RESULT_STREAM_MAX_RECORD 64
+#define RESULT_STREAM_MAX_FRAME (RESULT_STREAM_MAX_RECORD + 2 + 2 + 1)
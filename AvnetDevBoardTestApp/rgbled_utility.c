@@ -5,11 +5,12 @@
 #include <applibs/log.h>
 
 #include "rgbled_utility.h"
+#include "gpio_pool.h"
 
 /// <summary>
-///     Maximum number of managed LEDs.
+///     Maximum number of managed LEDs: the user LED and one status LED per test category.
 /// </summary>
-#define MAX_LED_COUNT 1
+#define MAX_LED_COUNT 4
 
 
 static const char *colorNames[] = {"white", "blue",   "cyan",    "green",
@@ -19,9 +20,22 @@ static const RgbLedUtility_Colors colors[] = {
     RgbLedUtility_Colors_Green,   RgbLedUtility_Colors_Red,  RgbLedUtility_Colors_Yellow,
     RgbLedUtility_Colors_Magenta, RgbLedUtility_Colors_Off};
 
+/// <summary>
+///     Mask of the color bits, one per channel.
+/// </summary>
+#define ALL_CHANNELS ((0x1u << NUM_CHANNELS) - 1)
+
 static RgbLed rgbLeds[MAX_LED_COUNT];
+static GPIO_Id rgbLedGpios[MAX_LED_COUNT][NUM_CHANNELS];
 static size_t openedLeds = 0;
 
+// Shadow copy of what each opened LED shows: one color bit per channel, and which of those bits
+// are known to match the GPIO.  Channels only get written when their bit changes.
+static unsigned shadowState[MAX_LED_COUNT];
+static unsigned shadowKnown[MAX_LED_COUNT];
+
+static RgbLedUtility_Stats stats;
+
 int RgbLedUtility_OpenLeds(RgbLed **outLeds, size_t ledCount, const int (*ledGpios)[NUM_CHANNELS])
 {
     if (ledCount > MAX_LED_COUNT) {
@@ -33,7 +47,7 @@ int RgbLedUtility_OpenLeds(RgbLed **outLeds, size_t ledCount, const int (*ledGpi
         Log_Debug("INFO: Open RGB Status LED %d.\n", i);
         for (int channel = 0; channel < NUM_CHANNELS; channel++) {
             outLeds[i]->channel[channel] =
-                GPIO_OpenAsOutput(ledGpios[i][channel], GPIO_OutputMode_PushPull, GPIO_Value_High);
+                GpioPool_OpenAsOutput(ledGpios[i][channel], GPIO_Value_High);
             if (outLeds[i]->channel[channel] < 0) {
                 Log_Debug("ERROR: Could not open LED.\n");
                 return -1;
@@ -43,23 +57,106 @@ int RgbLedUtility_OpenLeds(RgbLed **outLeds, size_t ledCount, const int (*ledGpi
             // They are needed when converting from a raw LED pointer to an index inside
             // the rgbLeds structure.
             rgbLeds[i].channel[channel] = outLeds[i]->channel[channel];
+            rgbLedGpios[i][channel] = ledGpios[i][channel];
         }
+
+        // The channels were opened high, which is off
+        shadowState[i] = 0;
+        shadowKnown[i] = ALL_CHANNELS;
     }
 
     openedLeds = ledCount;
     return 0;
 }
 
-int RgbLedUtility_SetLed(const RgbLed *led, RgbLedUtility_Colors colorRequested)
+/// <summary>
+///     Returns the index of an opened LED in rgbLeds, or -1 if it was not opened by this utility.
+/// </summary>
+static int LedIndex(const RgbLed *led)
 {
-    int result;
+    for (size_t i = 0; i < openedLeds; i++) {
+        if (rgbLeds[i].channel[0] == led->channel[0]) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/// <summary>
+///     Drives the channels of an LED to the given color bits, skipping every channel whose shadow
+///     state already matches. A channel whose write fails is marked unknown so the next update
+///     writes it again. Opened LEDs are written through the GPIO pool, which other tests may use to
+///     drive the same pins.
+/// </summary>
+static int WriteChannels(const RgbLed *led, int index, unsigned colorBits)
+{
+    int result = 0;
 
     for (int channel = 0; channel < NUM_CHANNELS; channel++) {
-        bool isOn = (int)colorRequested & (0x1 << channel);
+        unsigned bit = 0x1u << channel;
+        if (index >= 0 && (shadowKnown[index] & bit) && ((shadowState[index] ^ colorBits) & bit) == 0) {
+            stats.writesAvoided++;
+            continue;
+        }
 
-        result = GPIO_SetValue(led->channel[channel], isOn ? GPIO_Value_Low : GPIO_Value_High);
-        if (result != 0) {
-            Log_Debug("ERROR: Cannot change RGB LED 0x%x color.\n", led);
+        stats.writes++;
+        GPIO_Value_Type level = (colorBits & bit) ? GPIO_Value_Low : GPIO_Value_High;
+        int written = (index >= 0) ? GpioPool_SetValue(rgbLedGpios[index][channel], level)
+                                   : GPIO_SetValue(led->channel[channel], level);
+        if (written != 0) {
+            Log_Debug("ERROR: Cannot change RGB LED 0x%x channel %d color.\n", led, channel);
+            stats.errors++;
+            result = -1;
+            if (index >= 0) {
+                shadowKnown[index] &= ~bit;
+            }
+            continue;
+        }
+        if (index >= 0) {
+            shadowKnown[index] |= bit;
+            shadowState[index] = (shadowState[index] & ~bit) | (colorBits & bit);
+        }
+    }
+    return result;
+}
+
+void RgbLedUtility_ForgetState(void)
+{
+    for (size_t i = 0; i < openedLeds; i++) {
+        shadowKnown[i] = 0;
+    }
+}
+
+int RgbLedUtility_SetLed(const RgbLed *led, RgbLedUtility_Colors colorRequested)
+{
+    return WriteChannels(led, LedIndex(led), (unsigned)colorRequested & ALL_CHANNELS);
+}
+
+int RgbLedUtility_SetLeds(const RgbLedUtility_Update *updates, size_t updateCount)
+{
+    unsigned target[MAX_LED_COUNT] = {0};
+    bool updated[MAX_LED_COUNT] = {false};
+    int result = 0;
+
+    // Only the last update of each LED is written
+    for (size_t i = 0; i < updateCount; i++) {
+        int index = LedIndex(updates[i].led);
+        if (index < 0) {
+            if (WriteChannels(updates[i].led, -1, (unsigned)updates[i].color & ALL_CHANNELS) != 0) {
+                result = -1;
+            }
+            continue;
+        }
+        if (updated[index]) {
+            stats.updatesMerged++;
+        }
+        target[index] = (unsigned)updates[i].color & ALL_CHANNELS;
+        updated[index] = true;
+    }
+
+    for (size_t i = 0; i < openedLeds; i++) {
+        if (updated[i] && WriteChannels(&rgbLeds[i], (int)i, target[i]) != 0) {
+            result = -1;
         }
     }
     return result;
@@ -71,8 +168,9 @@ void RgbLedUtility_CloseLeds(RgbLed **leds, size_t ledCount)
         for (int channel = 0; channel < NUM_CHANNELS; channel++) {
             int ledFd = leds[i]->channel[channel];
             if (ledFd >= 0) {
-                GPIO_SetValue(ledFd, GPIO_Value_High); // off
-                close(ledFd);
+                GpioPool_SetValue(rgbLedGpios[i][channel], GPIO_Value_High); // off
+                // The handle belongs to the GPIO pool, which closes it at shutdown.
+                leds[i]->channel[channel] = -1;
             }
         }
     }
@@ -80,6 +178,21 @@ void RgbLedUtility_CloseLeds(RgbLed **leds, size_t ledCount)
     openedLeds = 0;
 }
 
+void RgbLedUtility_GetStats(RgbLedUtility_Stats *outStats)
+{
+    *outStats = stats;
+}
+
+void RgbLedUtility_LogStats(void)
+{
+    if (stats.writes + stats.writesAvoided > 0) {
+        Log_Debug("INFO: RGB LEDs: %u channel writes, %u skipped as unchanged, %u updates merged, "
+                  "%u errors.\n",
+                  stats.writes, stats.writesAvoided, stats.updatesMerged, stats.errors);
+    }
+    memset(&stats, 0, sizeof(stats));
+}
+
 RgbLedUtility_Colors RgbLedUtility_GetColorFromString(const char *colorName, size_t colorNameSize)
 {
     RgbLedUtility_Colors returnedColor = RgbLedUtility_Colors_Unknown;
@@ -2,6 +2,7 @@
 
 #include <time.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <applibs/gpio.h>
 
@@ -41,6 +42,36 @@ typedef enum {
     RgbLedUtility_Colors_Unknown = 8  // 1000 binary
 } RgbLedUtility_Colors;
 
+/// <summary>
+///     One entry of a batch passed to RgbLedUtility_SetLeds.
+/// </summary>
+typedef struct {
+    const RgbLed *led;
+    RgbLedUtility_Colors color;
+} RgbLedUtility_Update;
+
+/// <summary>
+///     Counters gathered since the last call to RgbLedUtility_LogStats.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     GPIO_SetValue calls made
+    /// </summary>
+    uint32_t writes;
+    /// <summary>
+    ///     Channel writes skipped because the channel already showed the requested level
+    /// </summary>
+    uint32_t writesAvoided;
+    /// <summary>
+    ///     Batch entries dropped because a later entry in the same batch set the same LED
+    /// </summary>
+    uint32_t updatesMerged;
+    /// <summary>
+    ///     GPIO_SetValue calls that failed
+    /// </summary>
+    uint32_t errors;
+} RgbLedUtility_Stats;
+
 /// <summary>
 ///     Opens the first 'n' LEDs as defined in the ledGpios array, where n is ledCount, and returns
 ///     their file descriptors via the provided 'leds' array.
@@ -59,12 +90,40 @@ int RgbLedUtility_OpenLeds(RgbLed **outLeds, size_t ledCount, const int (*ledGpi
 void RgbLedUtility_CloseLeds(RgbLed **leds, size_t ledCount);
 
 /// <summary>
-///     Changes the color of an RGB LED.
+///     Changes the color of an RGB LED. Only the channels that differ from the LED's current
+///     color are written.
 /// </summary>
 /// <param name="leds">An RgbLed.</param>
 /// <param name="color">The color to change to.</param>
+/// <returns>0 on success, or -1 if any channel could not be written.</returns>
 int RgbLedUtility_SetLed(const RgbLed *led, RgbLedUtility_Colors color);
 
+/// <summary>
+///     Applies a batch of color changes. When an LED appears more than once only its last entry is
+///     used, and only the channels that differ from each LED's current color are written.
+/// </summary>
+/// <param name="updates">The LEDs to change and their new colors.</param>
+/// <param name="updateCount">The number of entries in updates.</param>
+/// <returns>0 on success, or -1 if any channel could not be written.</returns>
+int RgbLedUtility_SetLeds(const RgbLedUtility_Update *updates, size_t updateCount);
+
+/// <summary>
+///     Marks the state of every opened LED unknown, so the next update writes all of its channels.
+///     Call this after other code has driven the LED GPIOs, for example a test that uses them.
+/// </summary>
+void RgbLedUtility_ForgetState(void);
+
+/// <summary>
+///     Copies the counters gathered since the last call to RgbLedUtility_LogStats.
+/// </summary>
+/// <param name="outStats">Receives the counters</param>
+void RgbLedUtility_GetStats(RgbLedUtility_Stats *outStats);
+
+/// <summary>
+///     Logs the channel writes made and avoided, then resets the counters.
+/// </summary>
+void RgbLedUtility_LogStats(void);
+
 /// <summary>
 ///     Searches in the given string the first occurence of one of the color's name
 ///     defined in the RgbLedUtility_Colors enum (e.g. "red" for RgbLedUtility_Colors_Red), and
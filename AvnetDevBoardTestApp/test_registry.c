@@ -0,0 +1,434 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <applibs/log.h>
+
+#include "test_registry.h"
+
+// MT3620 GPIO number of the first pin of ISU0-ISU4; each ISU uses four pins
+static const int isuFirstGpio[] = {26, 31, 36, 66, 71};
+
+/// <summary>
+///     Progress of one test in the current run.
+/// </summary>
+typedef enum {
+    TestRegistry_State_Pending = 0,
+    TestRegistry_State_Running = 1,
+    TestRegistry_State_Finished = 2
+} TestRegistry_State;
+
+/// <summary>
+///     A registered test and its timing in the current run.
+/// </summary>
+typedef struct {
+    const TestDescriptor *test;
+    TestRegistry_State state;
+    int group;
+    bool passed;
+    int failureIndex;
+    int failurePins[2];
+    struct timespec start;
+    struct timespec end;
+} TestRegistry_Entry;
+
+static TestRegistry_Entry entries[TEST_REGISTRY_MAX_TESTS];
+static int entryCount = 0;
+
+// Conflict graph: bit j of conflicts[i] is set when tests i and j share a resource
+static uint32_t conflicts[TEST_REGISTRY_MAX_TESTS];
+
+// Resources held for the whole life of the application, e.g. the button pins
+static TestResources reserved;
+static const char *reservedOwner = "";
+
+// Schedule: tests run group by group, every test in a group at the same time
+static int groupCount = 0;
+static int currentGroup = 0;
+
+static int registryEpollFd = -1;
+static bool running = false;
+static bool scheduling = false;
+static struct timespec runStart;
+static struct timespec runEnd;
+static void (*runDoneHandler)(bool allPassed) = NULL;
+
+static void Schedule(void);
+
+/// <summary>
+///     Returns the milliseconds from one timestamp to another.
+/// </summary>
+static long ElapsedMs(const struct timespec *from, const struct timespec *to)
+{
+    return (long)((to->tv_sec - from->tv_sec) * 1000 + (to->tv_nsec - from->tv_nsec) / 1000000);
+}
+
+/// <summary>
+///     Records the end of a test and starts whatever it was holding up.
+/// </summary>
+static void TestDone(const TestDescriptor *test, bool passed)
+{
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].test == test && entries[i].state == TestRegistry_State_Running) {
+            clock_gettime(CLOCK_MONOTONIC, &entries[i].end);
+            entries[i].passed = passed;
+            entries[i].state = TestRegistry_State_Finished;
+            break;
+        }
+    }
+
+    Schedule();
+}
+
+/// <summary>
+///     Builds the conflict graph and colors it greedily into groups of tests that share no resource.
+///     Tests are placed longest first, each into the first group it does not conflict with, so long
+///     tests share a group and the predicted makespan (the sum of each group's longest test) stays short.
+/// </summary>
+static void BuildSchedule(void)
+{
+    int order[TEST_REGISTRY_MAX_TESTS];
+    uint32_t groupMembers[TEST_REGISTRY_MAX_TESTS];
+
+    // A blocking test conflicts with every other test, so it gets a group to itself
+    for (int i = 0; i < entryCount; i++) {
+        conflicts[i] = 0;
+        for (int j = 0; j < entryCount; j++) {
+            if (i != j && (entries[i].test->blocking || entries[j].test->blocking ||
+                           TestRegistry_ResourcesConflict(&entries[i].test->resources,
+                                                          &entries[j].test->resources))) {
+                conflicts[i] |= 1u << j;
+            }
+        }
+        order[i] = i;
+    }
+
+    // Insertion sort by expected duration, longest first; ties keep registration order
+    for (int i = 1; i < entryCount; i++) {
+        int index = order[i];
+        int j = i;
+        while (j > 0 && entries[order[j - 1]].test->expectedMs < entries[index].test->expectedMs) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = index;
+    }
+
+    groupCount = 0;
+    for (int i = 0; i < entryCount; i++) {
+        int index = order[i];
+        int group = 0;
+        while (group < groupCount && (groupMembers[group] & conflicts[index]) != 0) {
+            group++;
+        }
+        if (group == groupCount) {
+            groupMembers[groupCount++] = 0;
+        }
+        groupMembers[group] |= 1u << index;
+        entries[index].group = group;
+    }
+}
+
+/// <summary>
+///     Logs the conflicts, the groups and the predicted makespan.
+/// </summary>
+static void LogSchedule(void)
+{
+    long makespanMs = 0;
+    long serialMs = 0;
+
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].test->blocking) {
+            Log_Debug("TEST SCHEDULE: %s blocks the event loop and runs alone\n", entries[i].test->name);
+        }
+        for (int j = i + 1; j < entryCount; j++) {
+            if (TestRegistry_ResourcesConflict(&entries[i].test->resources, &entries[j].test->resources)) {
+                Log_Debug("TEST SCHEDULE: %s and %s share a resource\n", entries[i].test->name,
+                          entries[j].test->name);
+            }
+        }
+        if (TestRegistry_ResourcesConflict(&entries[i].test->resources, &reserved)) {
+            Log_Debug("TEST SCHEDULE: WARNING: %s uses pins held by the %s and fails without running\n",
+                      entries[i].test->name, reservedOwner);
+        }
+        serialMs += (long)entries[i].test->expectedMs;
+    }
+
+    for (int group = 0; group < groupCount; group++) {
+        long groupMs = 0;
+        char names[128];
+        size_t used = 0;
+        names[0] = '\0';
+        for (int i = 0; i < entryCount; i++) {
+            if (entries[i].group != group) {
+                continue;
+            }
+            if ((long)entries[i].test->expectedMs > groupMs) {
+                groupMs = (long)entries[i].test->expectedMs;
+            }
+            int written = snprintf(names + used, sizeof(names) - used, "%s%s", used == 0 ? "" : ", ",
+                                   entries[i].test->name);
+            if (written > 0 && (size_t)written < sizeof(names) - used) {
+                used += (size_t)written;
+            }
+        }
+        Log_Debug("TEST SCHEDULE: group %d, expected %ld ms: %s\n", group, groupMs, names);
+        makespanMs += groupMs;
+    }
+
+    Log_Debug("TEST SCHEDULE: predicted makespan %ld ms, %ld ms if run one after another\n", makespanMs,
+              serialMs);
+}
+
+/// <summary>
+///     Starts every test of the current group, moves on to the next group once they have all
+///     finished, and finishes the run after the last group. Tests that finish from within their
+///     start function re-enter through TestDone; the outer call picks up their effect on its next pass.
+/// </summary>
+static void Schedule(void)
+{
+    if (scheduling || !running) {
+        return;
+    }
+    scheduling = true;
+
+    while (currentGroup < groupCount) {
+        bool groupDone = true;
+        for (int i = 0; i < entryCount; i++) {
+            TestRegistry_Entry *entry = &entries[i];
+            if (entry->group != currentGroup) {
+                continue;
+            }
+            if (entry->state == TestRegistry_State_Pending) {
+                entry->state = TestRegistry_State_Running;
+                clock_gettime(CLOCK_MONOTONIC, &entry->start);
+                if (TestRegistry_ResourcesConflict(&entry->test->resources, &reserved)) {
+                    // Driving the pins would disturb their owner and read back whatever it does to them
+                    Log_Debug("TEST FAILURE: The %s test needs pins held by the %s\n", entry->test->name,
+                              reservedOwner);
+                    clock_gettime(CLOCK_MONOTONIC, &entry->end);
+                    entry->passed = false;
+                    entry->state = TestRegistry_State_Finished;
+                } else if (!entry->test->start(registryEpollFd, &TestDone)) {
+                    Log_Debug("TEST FAILURE: Could not start the %s test\n", entry->test->name);
+                    clock_gettime(CLOCK_MONOTONIC, &entry->end);
+                    entry->passed = false;
+                    entry->state = TestRegistry_State_Finished;
+                }
+            }
+            if (entry->state != TestRegistry_State_Finished) {
+                groupDone = false;
+            }
+        }
+        if (!groupDone) {
+            scheduling = false;
+            return;
+        }
+        currentGroup++;
+    }
+
+    scheduling = false;
+
+    bool allPassed = true;
+    for (int i = 0; i < entryCount; i++) {
+        allPassed = allPassed && entries[i].passed;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &runEnd);
+    running = false;
+    if (runDoneHandler != NULL) {
+        runDoneHandler(allPassed);
+    }
+}
+
+void TestRegistry_AddPin(TestResources *resources, GPIO_Id gpioId)
+{
+    if (gpioId >= 0 && gpioId < 128) {
+        resources->pins[gpioId / 64] |= 1ull << (gpioId % 64);
+    }
+}
+
+int TestRegistry_GetIsuFirstGpio(int isu)
+{
+    if (isu < 0 || isu >= (int)(sizeof(isuFirstGpio) / sizeof(*isuFirstGpio))) {
+        return -1;
+    }
+    return isuFirstGpio[isu];
+}
+
+void TestRegistry_AddUartPins(TestResources *resources, int isu)
+{
+    int firstGpio = TestRegistry_GetIsuFirstGpio(isu);
+    if (firstGpio < 0) {
+        return;
+    }
+    for (int pin = 0; pin < TEST_REGISTRY_UART_PIN_COUNT; pin++) {
+        TestRegistry_AddPin(resources, firstGpio + pin);
+    }
+}
+
+bool TestRegistry_ResourcesConflict(const TestResources *a, const TestResources *b)
+{
+    return (a->pins[0] & b->pins[0]) != 0 || (a->pins[1] & b->pins[1]) != 0 ||
+           (a->flags & b->flags) != 0;
+}
+
+void TestRegistry_Init(int epollFd)
+{
+    registryEpollFd = epollFd;
+}
+
+void TestRegistry_Reserve(const char *owner, const TestResources *resources)
+{
+    reservedOwner = owner;
+    reserved = *resources;
+}
+
+int TestRegistry_Register(const TestDescriptor *test)
+{
+    if (entryCount >= TEST_REGISTRY_MAX_TESTS) {
+        Log_Debug("ERROR: Test registry is full, cannot register the %s test.\n", test->name);
+        return -1;
+    }
+
+    memset(&entries[entryCount], 0, sizeof(entries[entryCount]));
+    entries[entryCount].test = test;
+    entries[entryCount].state = TestRegistry_State_Finished;
+    entryCount++;
+    return 0;
+}
+
+void TestRegistry_RunAll(void (*doneHandler)(bool allPassed))
+{
+    if (running) {
+        return;
+    }
+
+    for (int i = 0; i < entryCount; i++) {
+        entries[i].state = TestRegistry_State_Pending;
+        entries[i].passed = false;
+        entries[i].failureIndex = -1;
+        entries[i].failurePins[0] = -1;
+        entries[i].failurePins[1] = -1;
+    }
+
+    BuildSchedule();
+    LogSchedule();
+
+    runDoneHandler = doneHandler;
+    currentGroup = 0;
+    running = true;
+    clock_gettime(CLOCK_MONOTONIC, &runStart);
+    Schedule();
+}
+
+bool TestRegistry_Running(void)
+{
+    return running;
+}
+
+void TestRegistry_SetFailureIndex(const TestDescriptor *test, int index)
+{
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].test == test && entries[i].state == TestRegistry_State_Running) {
+            if (entries[i].failureIndex < 0) {
+                entries[i].failureIndex = index;
+            }
+            break;
+        }
+    }
+}
+
+void TestRegistry_SetFailurePins(const TestDescriptor *test, int pinA, int pinB)
+{
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].test == test && entries[i].state == TestRegistry_State_Running) {
+            if (entries[i].failurePins[0] < 0) {
+                entries[i].failurePins[0] = pinA;
+                entries[i].failurePins[1] = pinB;
+            }
+            break;
+        }
+    }
+}
+
+bool TestRegistry_GetFirstFailure(TestCategory *outCategory, int *outIndex)
+{
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].state == TestRegistry_State_Finished && !entries[i].passed) {
+            *outCategory = entries[i].test->category;
+            *outIndex = entries[i].failureIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+TestRegistry_Verdict TestRegistry_GetCategoryVerdict(TestCategory category)
+{
+    TestRegistry_Verdict verdict = TestRegistry_Verdict_NotRun;
+
+    for (int i = 0; i < entryCount; i++) {
+        if (entries[i].test->category != category || entries[i].state != TestRegistry_State_Finished) {
+            continue;
+        }
+        if (!entries[i].passed) {
+            return TestRegistry_Verdict_Failed;
+        }
+        verdict = TestRegistry_Verdict_Passed;
+    }
+    return verdict;
+}
+
+void TestRegistry_LogTimings(void)
+{
+    long expectedTotalMs = 0;
+
+    Log_Debug("TEST TIMING: test              start ms  took ms  expected ms  result\n");
+    for (int i = 0; i < entryCount; i++) {
+        const TestRegistry_Entry *entry = &entries[i];
+        if (entry->state != TestRegistry_State_Finished) {
+            Log_Debug("TEST TIMING: %-16s  not run\n", entry->test->name);
+            continue;
+        }
+        Log_Debug("TEST TIMING: %-16s  %8ld  %7ld  %11lu  %s\n", entry->test->name,
+                  ElapsedMs(&runStart, &entry->start), ElapsedMs(&entry->start, &entry->end),
+                  (unsigned long)entry->test->expectedMs, entry->passed ? "passed" : "FAILED");
+        expectedTotalMs += (long)entry->test->expectedMs;
+    }
+    Log_Debug("TEST TIMING: run took %ld ms; the tests one after another are expected to take %ld ms\n",
+              ElapsedMs(&runStart, &runEnd), expectedTotalMs);
+}
+
+int TestRegistry_GetTestCount(void)
+{
+    return entryCount;
+}
+
+bool TestRegistry_GetResult(int index, TestRegistry_Result *outResult)
+{
+    if (index < 0 || index >= entryCount) {
+        return false;
+    }
+
+    const TestRegistry_Entry *entry = &entries[index];
+    outResult->test = entry->test;
+    outResult->failureIndex = entry->failureIndex;
+    outResult->failurePins[0] = entry->failurePins[0];
+    outResult->failurePins[1] = entry->failurePins[1];
+    if (entry->state != TestRegistry_State_Finished) {
+        outResult->verdict = TestRegistry_Verdict_NotRun;
+        outResult->startMs = 0;
+        outResult->durationMs = 0;
+        return true;
+    }
+    outResult->verdict = entry->passed ? TestRegistry_Verdict_Passed : TestRegistry_Verdict_Failed;
+    outResult->startMs = (uint32_t)ElapsedMs(&runStart, &entry->start);
+    outResult->durationMs = (uint32_t)ElapsedMs(&entry->start, &entry->end);
+    return true;
+}
+
+uint32_t TestRegistry_GetRunDurationMs(void)
+{
+    return (uint32_t)ElapsedMs(&runStart, &runEnd);
+}
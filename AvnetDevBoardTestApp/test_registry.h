@@ -0,0 +1,222 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <applibs/gpio.h>
+
+/// <summary>
+///     Maximum number of tests that can be registered.
+/// </summary>
+#define TEST_REGISTRY_MAX_TESTS 16
+
+/// <summary>
+///     Shared resources a test can claim besides GPIO pins.
+/// </summary>
+#define TEST_RESOURCE_RGB_LED 0x01u
+#define TEST_RESOURCE_WIFI 0x02u
+
+/// <summary>
+///     What a test uses. Two tests whose resources overlap never run at the same time.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     One bit per GPIO_Id (0-127), including the pins of any UART the test opens
+    /// </summary>
+    uint64_t pins[2];
+    /// <summary>
+    ///     TEST_RESOURCE_* flags
+    /// </summary>
+    uint32_t flags;
+} TestResources;
+
+/// <summary>
+///     Subsystem a test checks, so results can be reported per subsystem.
+/// </summary>
+typedef enum {
+    TestCategory_Other = 0,
+    TestCategory_Gpio = 1,
+    TestCategory_Uart = 2,
+    TestCategory_Wifi = 3,
+    TestCategory_Led = 4
+} TestCategory;
+
+/// <summary>
+///     Combined result of the tests in one category in the last run.
+/// </summary>
+typedef enum {
+    TestRegistry_Verdict_NotRun = 0,
+    TestRegistry_Verdict_Passed = 1,
+    TestRegistry_Verdict_Failed = 2
+} TestRegistry_Verdict;
+
+typedef struct TestDescriptor TestDescriptor;
+
+/// <summary>
+///     Result of one registered test in the last run.
+/// </summary>
+typedef struct {
+    /// <summary>
+    ///     The test
+    /// </summary>
+    const TestDescriptor *test;
+    /// <summary>
+    ///     Passed or Failed, or NotRun if the test did not finish
+    /// </summary>
+    TestRegistry_Verdict verdict;
+    /// <summary>
+    ///     When the test started, in milliseconds from the start of the run
+    /// </summary>
+    uint32_t startMs;
+    /// <summary>
+    ///     How long the test took, in milliseconds
+    /// </summary>
+    uint32_t durationMs;
+    /// <summary>
+    ///     Item that failed, see TestRegistry_SetFailureIndex, or -1
+    /// </summary>
+    int failureIndex;
+    /// <summary>
+    ///     GPIOs that failed, see TestRegistry_SetFailurePins, or -1
+    /// </summary>
+    int failurePins[2];
+} TestRegistry_Result;
+
+/// <summary>
+///     Called by a test when it has finished. It may be called from within the test's start function.
+/// </summary>
+typedef void (*TestDoneHandler)(const TestDescriptor *test, bool passed);
+
+/// <summary>
+///     A registered test.
+/// </summary>
+struct TestDescriptor {
+    /// <summary>
+    ///     Name used in the timing breakdown
+    /// </summary>
+    const char *name;
+    /// <summary>
+    ///     What the test uses
+    /// </summary>
+    TestResources resources;
+    /// <summary>
+    ///     How long the test is expected to take, in milliseconds
+    /// </summary>
+    uint32_t expectedMs;
+    /// <summary>
+    ///     Starts the test. The test runs from the epoll instance and calls doneHandler with its own
+    ///     descriptor when it has finished. Returns false if the test could not be started.
+    /// </summary>
+    bool (*start)(int epollFd, TestDoneHandler doneHandler);
+    /// <summary>
+    ///     Subsystem the test checks
+    /// </summary>
+    TestCategory category;
+    /// <summary>
+    ///     Set if the start function runs the whole test before it returns. The event loop stalls
+    ///     meanwhile, so a blocking test runs in a group of its own rather than beside timer-driven tests.
+    /// </summary>
+    bool blocking;
+};
+
+/// <summary>
+///     Adds a GPIO to a resource set.
+/// </summary>
+void TestRegistry_AddPin(TestResources *resources, GPIO_Id gpioId);
+
+/// <summary>
+///     Number of GPIOs an ISU UART uses: TX, RX, RTS and CTS, in that order from the first.
+/// </summary>
+#define TEST_REGISTRY_UART_PIN_COUNT 4
+
+/// <summary>
+///     Returns the first GPIO of an ISU (0-4), or -1 if there is no such ISU.
+/// </summary>
+int TestRegistry_GetIsuFirstGpio(int isu);
+
+/// <summary>
+///     Adds the TX, RX, RTS and CTS pins of an ISU UART to a resource set.
+/// </summary>
+void TestRegistry_AddUartPins(TestResources *resources, int isu);
+
+/// <summary>
+///     Returns true if the two resource sets share a pin or a flag.
+/// </summary>
+bool TestRegistry_ResourcesConflict(const TestResources *a, const TestResources *b);
+
+/// <summary>
+///     Sets the epoll instance the tests run on.
+/// </summary>
+void TestRegistry_Init(int epollFd);
+
+/// <summary>
+///     Records resources held for the whole life of the application, such as the button pins. Tests
+///     that use them are reported when the schedule is built and fail without being started.
+/// </summary>
+void TestRegistry_Reserve(const char *owner, const TestResources *resources);
+
+/// <summary>
+///     Adds a test. The descriptor must stay valid.
+/// </summary>
+/// <returns>0 on success, or -1 if the registry is full.</returns>
+int TestRegistry_Register(const TestDescriptor *test);
+
+/// <summary>
+///     Runs every registered test. The tests are colored into groups that share no resource, and the
+///     groups run one after another with every test in a group running at the same time. A blocking
+///     test is always alone in its group. The groups
+///     and the predicted makespan are logged. doneHandler is called with the overall result once all
+///     tests have finished.
+/// </summary>
+void TestRegistry_RunAll(void (*doneHandler)(bool allPassed));
+
+/// <summary>
+///     Returns true while a run is in progress.
+/// </summary>
+bool TestRegistry_Running(void);
+
+/// <summary>
+///     Records which item of a running test failed, e.g. the GPIO pair or ISU number, so the failure
+///     can be reported without the debug output. Only the first index recorded in a run is kept.
+/// </summary>
+void TestRegistry_SetFailureIndex(const TestDescriptor *test, int index);
+
+/// <summary>
+///     Records the GPIOs involved in the failure of a running test, e.g. the two pins of a loopback pair,
+///     or -1 for an unused one. Only the first pins recorded in a run are kept.
+/// </summary>
+void TestRegistry_SetFailurePins(const TestDescriptor *test, int pinA, int pinB);
+
+/// <summary>
+///     Finds the first registered test that failed in the last run.
+/// </summary>
+/// <param name="outCategory">Receives the category of the test</param>
+/// <param name="outIndex">Receives the index the test recorded, or -1 if it did not record one</param>
+/// <returns>true if a test failed</returns>
+bool TestRegistry_GetFirstFailure(TestCategory *outCategory, int *outIndex);
+
+/// <summary>
+///     Returns Failed if any test of the category failed in the last run, Passed if they all passed,
+///     and NotRun if the category has no finished test.
+/// </summary>
+TestRegistry_Verdict TestRegistry_GetCategoryVerdict(TestCategory category);
+
+/// <summary>
+///     Logs the start offset, duration, expected duration and result of each test in the last run.
+/// </summary>
+void TestRegistry_LogTimings(void);
+
+/// <summary>
+///     Returns the number of registered tests.
+/// </summary>
+int TestRegistry_GetTestCount(void);
+
+/// <summary>
+///     Gets the result of a registered test in the last run, in registration order.
+/// </summary>
+/// <returns>false if index is not a registered test</returns>
+bool TestRegistry_GetResult(int index, TestRegistry_Result *outResult);
+
+/// <summary>
+///     Returns how long the last run took, in milliseconds.
+/// </summary>
+uint32_t TestRegistry_GetRunDurationMs(void);
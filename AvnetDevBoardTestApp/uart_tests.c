@@ -1,15 +1,20 @@
-
 //#include <applibs/gpio.h>
 #include <applibs/log.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "platform.h"
 #include "uart_tests.h"
+#include "coroutine.h"
+#include "gpio_pool.h"
+#include "test_registry.h"
 
 // applibs_versions.h defines the API struct versions to use for applibs APIs.
 #include "applibs_versions.h"
@@ -19,133 +24,720 @@
 // Termination state
 extern sig_atomic_t terminationRequired;
 
-//bool testUART(UART_Id);
-//static void SendUartMessage(int, const char*);
-//bool stringsMatch(char*, const char*, int);
-
 // Determine how many UARTs we have to test
 static const int numUARTs = sizeof(uartIDs) / sizeof(GPIO_Id);
 
+// The message sent over each loopback
+static const char *testString = "Testing, Testing, 1, 2, 3";
+
+// Receive ring buffer size, must be a power of two
+#define UART_RING_SIZE 256
+
+// In bit error mode a mismatch is checked for a slipped byte before it is counted as bit errors: the received bytes
+// are realigned with the payload if UART_SLIP_WINDOW bytes match with up to UART_SLIP_MAX bytes dropped or inserted
+#define UART_SLIP_WINDOW 4
+#define UART_SLIP_MAX 8
+
+/// <summary>
+///     Bytes received from a UART and not yet compared.  head and tail run freely and are masked on access.
+/// </summary>
+typedef struct {
+	uint8_t data[UART_RING_SIZE];
+	size_t head;
+	size_t tail;
+} UartRing;
+
+/// <summary>
+///     Transmit/receive state of one UART loopback test.
+/// </summary>
+typedef struct {
+	UART_Id uartId;
+	int uartFd;
+	bool opened;
+	struct timespec deadline;
+	const uint8_t *txData;
+	size_t txLength;
+	size_t txSent;
+	size_t rxCount;
+	size_t expected;
+	uint32_t bitErrors;
+	uint32_t bytesLost;
+	uint32_t bytesExtra;
+	bool countBitErrors;
+	UartRing ring;
+	bool done;
+	bool passed;
+	struct timespec start;
+	bool transferring;
+	struct timespec firstByte;
+	struct timespec lastReceived;
+	struct timespec end;
+} UartPortTest;
+
+// One test per UART in uartIDs[], each run by its own coroutine on the main epoll instance.  The coroutines are kept
+// apart from the ports, which are cleared at the start of every transfer.
+static UartPortTest uartPorts[sizeof(uartIDs) / sizeof(UART_Id) + 1];
+static coroutine_t uartCoroutines[sizeof(uartIDs) / sizeof(UART_Id) + 1];
+
+// The transfers in progress: how many ports take part, and what to call once every one has finished
+static int uartEpollFd = -1;
+static int uartTransferCount = 0;
+static bool uartTransfersStarting = false;
+static void (*uartTransfersDoneHandler)(void) = NULL;
+
+/// <summary>
+///     Returns the time the payload takes on the wire: a start bit, eight data bits and a stop bit per byte.
+/// </summary>
+static uint64_t uartWireNs(uint32_t baudRate, size_t payloadLength) {
+
+	return (uint64_t)payloadLength * 10u * 1000000000u / baudRate;
+}
+
+/// <summary>
+///     Computes how long to wait for the whole payload: the time the bytes take on the wire, half as much again, and
+///     a fixed margin for scheduling.
+/// </summary>
+static struct timespec uartDeadline(uint32_t baudRate, size_t payloadLength) {
+
+	uint64_t wireNs = uartWireNs(baudRate, payloadLength);
+	uint64_t deadlineNs = wireNs + wireNs / 2 + (uint64_t)UART_DEADLINE_MARGIN_MS * 1000000u;
+	struct timespec deadline = { (time_t)(deadlineNs / 1000000000u), (long)(deadlineNs % 1000000000u) };
+	return deadline;
+}
+
+/// <summary>
+///     Marks the test finished and records the end time.
+/// </summary>
+static void finishUartTest(UartPortTest *port, bool passed) {
+
+	if (port->done) {
+		return;
+	}
+	port->done = true;
+	port->passed = passed;
+	clock_gettime(CLOCK_MONOTONIC, &port->end);
+}
+
+/// <summary>
+///     Records the time of the first byte written or received, where the transfer's throughput is timed from.
+/// </summary>
+static void markUartTransferring(UartPortTest *port) {
+
+	if (!port->transferring) {
+		port->transferring = true;
+		clock_gettime(CLOCK_MONOTONIC, &port->firstByte);
+	}
+}
+
 /// <summary>
-///     Helper function to send a fixed message via the given UART.
+///     Writes as much of the remaining payload as the UART accepts.
 /// </summary>
-/// <param name="uartFd">The open file descriptor of the UART to write to</param>
-/// <param name="dataToSend">The data to send over the UART</param>
-static void SendUartMessage(int uartFd, const char *dataToSend)
-{
-	size_t totalBytesSent = 0;
-	size_t totalBytesToSend = strlen(dataToSend);
-	int sendIterations = 0;
-	while (totalBytesSent < totalBytesToSend) {
-		sendIterations++;
+static void transmitUartData(UartPortTest *port) {
 
-		// Send as much of the remaining data as possible
-		size_t bytesLeftToSend = totalBytesToSend - totalBytesSent;
-		const char *remainingMessageToSend = dataToSend + totalBytesSent;
-		ssize_t bytesSent = write(uartFd, remainingMessageToSend, bytesLeftToSend);
+	while (port->txSent < port->txLength) {
+		ssize_t bytesSent = write(port->uartFd, port->txData + port->txSent, port->txLength - port->txSent);
 		if (bytesSent < 0) {
+			if (errno == EAGAIN) {
+				return;
+			}
 			Log_Debug("ERROR: Could not write to UART: %s (%d).\n", strerror(errno), errno);
 			terminationRequired = true;
+			finishUartTest(port, false);
 			return;
 		}
+		if (bytesSent > 0) {
+			markUartTransferring(port);
+		}
+		port->txSent += (size_t)bytesSent;
+	}
+}
+
+/// <summary>
+///     Moves every byte the UART has received into the ring buffer.
+/// </summary>
+static void receiveUartData(UartPortTest *port) {
+
+	while (port->ring.head - port->ring.tail < UART_RING_SIZE) {
+		size_t offset = port->ring.head & (UART_RING_SIZE - 1);
+		size_t space = UART_RING_SIZE - (port->ring.head - port->ring.tail);
+		if (space > UART_RING_SIZE - offset) {
+			space = UART_RING_SIZE - offset;
+		}
 
-		totalBytesSent += (size_t)bytesSent;
+		ssize_t bytesRead = read(port->uartFd, &port->ring.data[offset], space);
+		if (bytesRead < 0) {
+			if (errno != EAGAIN) {
+				Log_Debug("ERROR: Could not read UART: %s (%d)\n", strerror(errno), errno);
+				terminationRequired = true;
+				finishUartTest(port, false);
+			}
+			return;
+		}
+		if (bytesRead == 0) {
+			return;
+		}
+		markUartTransferring(port);
+		port->ring.head += (size_t)bytesRead;
+		clock_gettime(CLOCK_MONOTONIC, &port->lastReceived);
 	}
+}
 
-	//	Log_Debug("INFO: Sent %zu bytes over UART in %d calls\n", totalBytesSent, sendIterations);
+/// <summary>
+///     Returns the received byte offset bytes past the oldest one still buffered.
+/// </summary>
+static uint8_t peekUartData(const UartPortTest *port, size_t offset) {
+
+	return port->ring.data[(port->ring.tail + offset) & (UART_RING_SIZE - 1)];
 }
 
-bool stringsMatch(char* string1, const  char* string2, int len) {
+/// <summary>
+///     Returns true if the buffered bytes from receivedOffset on match the payload from expected on, for
+///     UART_SLIP_WINDOW bytes or up to the end of the payload.
+/// </summary>
+static bool uartDataAlignsAt(const UartPortTest *port, size_t receivedOffset, size_t expected) {
+
+	size_t available = port->ring.head - port->ring.tail;
+	size_t window = port->txLength - expected < UART_SLIP_WINDOW ? port->txLength - expected : UART_SLIP_WINDOW;
 
-	for (int i = 0; i < len; i++) {
-		if ((char)string1[i] != (char)string2[i]) {
-			Log_Debug("TEST FAILURE: UART compareString() Failed\n");
+	if (window == 0 || receivedOffset + window > available) {
+		return false;
+	}
+	for (size_t i = 0; i < window; i++) {
+		if (peekUartData(port, receivedOffset + i) != port->txData[expected + i]) {
 			return false;
 		}
 	}
 	return true;
 }
 
+/// <summary>
+///     Bit error mode: compares the buffered bytes with the payload and counts the bits that differ.  A mismatch that
+///     realigns with the payload after dropping or inserting bytes is counted as lost or extra bytes instead, so one
+///     slipped byte does not turn the rest of the payload into bit errors.  A mismatch waits for enough bytes to
+///     look for a slip unless flush is set, when the bytes still buffered are all compared.
+/// </summary>
+static void countUartBitErrors(UartPortTest *port, bool flush) {
+
+	while (port->ring.tail != port->ring.head) {
+		uint8_t received = peekUartData(port, 0);
+
+		if (port->expected >= port->txLength) {
+			port->bytesExtra++;
+		}
+		else if (received == port->txData[port->expected]) {
+			port->expected++;
+		}
+		else {
+			if (!flush && port->ring.head - port->ring.tail < UART_SLIP_MAX + UART_SLIP_WINDOW &&
+				port->txLength - port->expected > 1) {
+				return;
+			}
+
+			bool realigned = false;
+			for (size_t slip = 1; slip <= UART_SLIP_MAX && !realigned; slip++) {
+				if (port->expected + slip < port->txLength && uartDataAlignsAt(port, 0, port->expected + slip)) {
+					// Bytes were dropped; the received byte is compared again at its new position
+					port->bytesLost += (uint32_t)slip;
+					port->expected += slip;
+					realigned = true;
+				}
+				else if (uartDataAlignsAt(port, slip, port->expected)) {
+					// Bytes were inserted; skip them
+					port->bytesExtra += (uint32_t)slip;
+					port->ring.tail += slip;
+					port->rxCount += slip;
+					realigned = true;
+				}
+			}
+			if (realigned) {
+				continue;
+			}
+
+			port->bitErrors += (uint32_t)__builtin_popcount(received ^ port->txData[port->expected]);
+			port->expected++;
+		}
+
+		port->ring.tail++;
+		port->rxCount++;
+	}
+}
+
+/// <summary>
+///     Compares the buffered bytes against the expected payload as they arrive, failing on the first mismatch and
+///     passing as soon as the last byte matches.  In bit error mode the bytes are passed to countUartBitErrors.
+/// </summary>
+static void compareUartData(UartPortTest *port) {
+
+	if (port->countBitErrors) {
+		countUartBitErrors(port, false);
+		if (port->expected == port->txLength) {
+			finishUartTest(port, true);
+		}
+		return;
+	}
+
+	while (!port->done && port->ring.tail != port->ring.head) {
+		uint8_t received = port->ring.data[port->ring.tail & (UART_RING_SIZE - 1)];
+		port->ring.tail++;
+
+		if (port->rxCount >= port->txLength || received != port->txData[port->rxCount]) {
+			Log_Debug("TEST FAILURE: UART compare failed at byte %d on ISU%d\n", (int)port->rxCount, port->uartId - MT3620_UART_ISU0);
+			finishUartTest(port, false);
+			return;
+		}
+		port->rxCount++;
+	}
+
+	if (port->rxCount == port->txLength) {
+		finishUartTest(port, true);
+	}
+}
+
+/// <summary>
+///     The payload did not arrive by the deadline.  In bit error mode the bytes held back to look for a slip are
+///     compared now and the rest of the payload counts as lost.
+/// </summary>
+static void expireUartTest(UartPortTest *port) {
+
+	if (port->countBitErrors) {
+		countUartBitErrors(port, true);
+		port->bytesLost += (uint32_t)(port->txLength - port->expected);
+		port->expected = port->txLength;
+	}
+	else {
+		Log_Debug("TEST FAILURE: UART deadline expired on ISU%d after %d of %d bytes\n", port->uartId - MT3620_UART_ISU0, (int)port->rxCount, (int)port->txLength);
+	}
+	finishUartTest(port, false);
+}
+
+/// <summary>
+///     Computes the time left until the port's deadline.
+/// </summary>
+/// <returns>false if the deadline has passed</returns>
+static bool uartTimeLeft(const UartPortTest *port, struct timespec *remaining) {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	int64_t remainingNs = (int64_t)(port->deadline.tv_sec - now.tv_sec) * 1000000000 + (port->deadline.tv_nsec - now.tv_nsec);
+	if (remainingNs <= 0) {
+		return false;
+	}
+	remaining->tv_sec = (time_t)(remainingNs / 1000000000);
+	remaining->tv_nsec = (long)(remainingNs % 1000000000);
+	return true;
+}
+
+/// <summary>
+///     One UART transfer: wait for the UART to be writable or to have received data, send what remains of the
+///     payload and check what has been received, until the whole payload has matched, the compare has failed or
+///     the deadline has passed.
+/// </summary>
+static int uartPortBody(coroutine_t *co) {
+
+	UartPortTest *port = co->context;
+	struct timespec remaining;
+
+	CO_BEGIN(co);
+
+	while (!port->done) {
+		if (!uartTimeLeft(port, &remaining)) {
+			expireUartTest(port);
+			break;
+		}
+
+		CO_AWAIT_FD(co, port->uartFd, (port->txSent < port->txLength) ? (EPOLLIN | EPOLLOUT) : EPOLLIN, &remaining);
+
+		if (Coroutine_TimedOut(co)) {
+			expireUartTest(port);
+			break;
+		}
+		if (port->txSent < port->txLength) {
+			transmitUartData(port);
+		}
+		receiveUartData(port);
+		compareUartData(port);
+	}
+
+	CO_END(co);
+}
+
+/// <summary>
+///     Calls the transfers' done handler once no port is still running.
+/// </summary>
+static void checkUartTransfersDone(void) {
+
+	if (uartTransfersStarting || uartTransfersDoneHandler == NULL) {
+		return;
+	}
+	for (int i = 0; i < uartTransferCount; i++) {
+		if (Coroutine_Running(&uartCoroutines[i])) {
+			return;
+		}
+	}
+
+	// The handler may start the next transfers
+	void (*doneHandler)(void) = uartTransfersDoneHandler;
+	uartTransfersDoneHandler = NULL;
+	doneHandler();
+}
+
+/// <summary>
+///     Closes the UART of a port.
+/// </summary>
+static void closeUartPort(UartPortTest *port) {
 
-bool testUART(UART_Id uartId) {
+	CloseFdAndPrintError(port->uartFd, "Uart");
+	port->uartFd = -1;
+}
 
-#define RECEIVE_BUFFER_SIZE 128
+/// <summary>
+///     Closes the UART once its transfer has finished.
+/// </summary>
+static void uartPortDone(coroutine_t *co) {
 
-	///<summary>static receive buffer for UART</summary>
+	closeUartPort(co->context);
+	checkUartTransfersDone();
+}
 
-	static int uartFd = -1;
+/// <summary>
+///     Closes any pooled GPIO handles on the pins of the given ISU (TX, RX, RTS, CTS), which other tests may keep
+///     open across runs, so the UART can claim them.
+/// </summary>
+static void releaseUartPins(UART_Id uartId) {
 
-	bool returnValue = true;
+	int firstGpio = TestRegistry_GetIsuFirstGpio(uartId - MT3620_UART_ISU0);
 
-	static char receiveBuffer[RECEIVE_BUFFER_SIZE];
-	memset(&receiveBuffer, 0, sizeof(receiveBuffer));
-	char *pchSegment = &receiveBuffer[0];
+	if (firstGpio < 0) {
+		return;
+	}
+	for (int pin = 0; pin < TEST_REGISTRY_UART_PIN_COUNT; pin++) {
+		GpioPool_Release(firstGpio + pin);
+	}
+}
 
-	const char* testString = "Testing, Testing, 1, 2, 3";
+/// <summary>
+///     Opens the UART and sets its deadline.  Sending starts when the UART reports it is writable.
+/// </summary>
+/// <returns>true on success, false if the UART could not be opened</returns>
+static bool startUartTest(UartPortTest *port, UART_Id uartId, const uint8_t *payload, size_t payloadLength, uint32_t baudRate,
+	bool countBitErrors) {
+
+	memset(port, 0, sizeof(*port));
+	port->uartId = uartId;
+	port->uartFd = -1;
+	port->txData = payload;
+	port->txLength = payloadLength;
+	port->countBitErrors = countBitErrors;
+	clock_gettime(CLOCK_MONOTONIC, &port->start);
 
 	// Create a UART_Config object, open the UART and set up UART event handler
 	UART_Config uartConfig;
 	UART_InitConfig(&uartConfig);
-	uartConfig.baudRate = 9600;
+	uartConfig.baudRate = baudRate;
 	uartConfig.flowControl = UART_FlowControl_None;
-	uartFd = UART_Open(uartId, &uartConfig);
-	if (uartFd < 0) {
+	releaseUartPins(uartId);
+	port->uartFd = UART_Open(uartId, &uartConfig);
+	if (port->uartFd < 0) {
 		Log_Debug("ERROR: Could not open UART: %s (%d).\n", strerror(errno), errno);
-		return -1;
+		return false;
 	}
 
-	// Send the canned message over the uart
-	SendUartMessage(uartFd, testString);
+	port->opened = true;
 
-	// Setup ts to ~0.02 seconds to allow time for the UART message to be received
-	struct timespec ts;
-	ts.tv_sec = 0;
-	ts.tv_nsec = 22222222;
-	nanosleep(&ts, NULL);
+	struct timespec timeout = uartDeadline(baudRate, payloadLength);
+	if (GetDeadlineAfter(&timeout, &port->deadline) != 0) {
+		return false;
+	}
 
-	// Poll the UART and store the byte(s)
-	ssize_t nBytesRead = read(uartFd, (void *)pchSegment, RECEIVE_BUFFER_SIZE);
+	return true;
+}
 
-	if (nBytesRead < 0) {
-		Log_Debug("ERROR: Could not read UART: %s (%d)\n", strerror(errno), errno);
-		terminationRequired = true;
-		return false;
+/// <summary>
+///     Starts sending the payload over each loopback and receiving it back, with every UART open at once so the
+///     transfers run concurrently and take as long as the slowest UART.  Each transfer is a coroutine on the epoll
+///     instance; once all have finished doneHandler is called, and the outcome of uartIdList[i] is in uartPorts[i].
+///     A port that could not be set up is finished and failed at once, with opened false if its UART did not open.
+/// </summary>
+static void startUartTransfers(const UART_Id *uartIdList, int uartCount, const uint8_t *payload, size_t payloadLength,
+	uint32_t baudRate, bool countBitErrors, void (*doneHandler)(void)) {
+
+	uartTransferCount = uartCount;
+	uartTransfersDoneHandler = doneHandler;
+	uartTransfersStarting = true;
+
+	for (int i = 0; i < uartCount; i++) {
+		UartPortTest *port = &uartPorts[i];
+
+		if (!startUartTest(port, uartIdList[i], payload, payloadLength, baudRate, countBitErrors)) {
+			// Mark it finished so the others still run to completion
+			finishUartTest(port, false);
+			closeUartPort(port);
+		}
+		else if (Coroutine_Start(&uartCoroutines[i], uartEpollFd, &uartPortBody, &uartPortDone, port) != 0) {
+			terminationRequired = true;
+			finishUartTest(port, false);
+			closeUartPort(port);
+		}
 	}
-	else {
-		if (nBytesRead == 0 || !stringsMatch(pchSegment, testString, nBytesRead)) {
-			Log_Debug("TEST FAILURE: UART test failed on ISU%d\n", uartId - 3);
-			returnValue = false;
+
+	uartTransfersStarting = false;
+	checkUartTransfersDone();
+}
+
+#ifdef UART_BENCHMARK
+
+// Largest payload the benchmark can send
+#define UART_BENCH_MAX_PAYLOAD 4096
+
+static uint8_t benchPayload[UART_BENCH_MAX_PAYLOAD];
+
+/// <summary>
+///     Fills the buffer with the PRBS15 sequence (x^15 + x^14 + 1), least significant bit first.
+/// </summary>
+static void fillPrbs15(uint8_t *buffer, size_t length) {
+
+	uint16_t lfsr = 0x7fff;
+
+	for (size_t i = 0; i < length; i++) {
+		uint8_t value = 0;
+		for (int bit = 0; bit < 8; bit++) {
+			uint16_t feedback = ((lfsr >> 14) ^ (lfsr >> 13)) & 1;
+			lfsr = (uint16_t)(((lfsr << 1) | feedback) & 0x7fff);
+			value |= (uint8_t)(feedback << bit);
 		}
-		else {
-#ifdef SHOW_DEBUG
-			Log_Debug("TEST INFO: Uart test passed for ISU%d\n", uartId - 3);
-#endif
+		buffer[i] = value;
+	}
+}
+
+// Where the sweep is: the UART, baud rate and payload size of the transfer in progress
+static int benchUart;
+static size_t benchBaudRate;
+static size_t benchPayloadSize;
+static void (*uartBenchmarkDoneHandler)(void) = NULL;
+
+static void uartBenchmarkNext(void);
+
+/// <summary>
+///     Logs the table row of the transfer that has just finished and starts the next one.
+/// </summary>
+static void uartBenchmarkStepDone(void) {
+
+	static const size_t numBaudRates = sizeof(uartBenchBaudRates) / sizeof(*uartBenchBaudRates);
+	static const size_t numPayloadSizes = sizeof(uartBenchPayloadSizes) / sizeof(*uartBenchPayloadSizes);
+
+	const UartPortTest *port = &uartPorts[0];
+	uint32_t baudRate = uartBenchBaudRates[benchBaudRate];
+	size_t payloadLength = port->txLength;
+
+	if (!port->opened) {
+		Log_Debug("  %7u  %6d   could not open the UART\n", baudRate, (int)payloadLength);
+	}
+	else {
+		// Throughput runs from the first byte written or received to the last byte received, so opening the UART
+		// and waiting for it to become writable are not counted.  Each byte takes ten bits on the wire, so the line
+		// rate is baudRate / 10 bytes per second.
+		double elapsed = (double)(port->lastReceived.tv_sec - port->firstByte.tv_sec) +
+			(double)(port->lastReceived.tv_nsec - port->firstByte.tv_nsec) / 1e9;
+		double bytesPerSecond = (port->rxCount > 0 && elapsed > 0) ? (double)port->rxCount / elapsed : 0.0;
+		double lineRate = bytesPerSecond / ((double)baudRate / 10.0);
+
+		// Bit errors are only counted on bytes that lined up with the payload; dropped and inserted bytes are
+		// counted on their own
+		Log_Debug("  %7u  %6d   %8d  %8.0f    %6.1f%%   %10u  %5u  %6u\n", baudRate, (int)payloadLength,
+			(int)port->rxCount, bytesPerSecond, lineRate * 100.0, port->bitErrors, port->bytesLost, port->bytesExtra);
+	}
+
+	if (++benchPayloadSize == numPayloadSizes) {
+		benchPayloadSize = 0;
+		if (++benchBaudRate == numBaudRates) {
+			benchBaudRate = 0;
+			benchUart++;
 		}
 	}
+	uartBenchmarkNext();
+}
+
+/// <summary>
+///     Starts the next transfer of the sweep, or calls the done handler once every combination has run.
+/// </summary>
+static void uartBenchmarkNext(void) {
+
+	if (benchUart >= numUARTs || terminationRequired) {
+		uartBenchmarkDoneHandler();
+		return;
+	}
+
+	if (benchBaudRate == 0 && benchPayloadSize == 0) {
+		Log_Debug("UART BENCHMARK: ISU%d\n", uartIDs[benchUart] - MT3620_UART_ISU0);
+		Log_Debug("  baud     bytes   received   bytes/s   line rate   bit errors   lost   extra\n");
+	}
+
+	size_t payloadLength = uartBenchPayloadSizes[benchPayloadSize];
+	if (payloadLength > UART_BENCH_MAX_PAYLOAD) {
+		payloadLength = UART_BENCH_MAX_PAYLOAD;
+	}
 
-	memset(&receiveBuffer, 0, sizeof(receiveBuffer));
-	CloseFdAndPrintError(uartFd, "Uart");
-	return returnValue;
+	// Each UART is benchmarked on its own so the figures are not shared with other ports
+	startUartTransfers(&uartIDs[benchUart], 1, benchPayload, payloadLength, uartBenchBaudRates[benchBaudRate], true,
+		&uartBenchmarkStepDone);
 }
 
+/// <summary>
+///     Sweeps every UART in uartIDs[] over the benchmark baud rates and payload sizes, one transfer after another,
+///     and logs a table row for each.  doneHandler is called once the sweep has finished.
+/// </summary>
+static void uartBenchmarkStart(void (*doneHandler)(void)) {
 
-bool uartTestsPassed(void) {
+	fillPrbs15(benchPayload, sizeof(benchPayload));
 
-	bool testsPassed = true;
+	benchUart = 0;
+	benchBaudRate = 0;
+	benchPayloadSize = 0;
+	uartBenchmarkDoneHandler = doneHandler;
+	uartBenchmarkNext();
+}
+
+static bool uartBenchStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor uartBenchDescriptor = { .name = "uart_bench", .start = &uartBenchStart,
+	.category = TestCategory_Uart };
+
+static TestDoneHandler uartBenchRegistryDoneHandler = NULL;
+
+/// <summary>
+///     Predicts the sweep's duration: every transfer's time on the wire plus UART_DEADLINE_MARGIN_MS for opening the
+///     UART and scheduling.
+/// </summary>
+static uint32_t uartBenchmarkExpectedMs(void) {
+
+	uint64_t sweepNs = 0;
+
+	for (size_t b = 0; b < sizeof(uartBenchBaudRates) / sizeof(*uartBenchBaudRates); b++) {
+		for (size_t p = 0; p < sizeof(uartBenchPayloadSizes) / sizeof(*uartBenchPayloadSizes); p++) {
+			size_t payloadLength = uartBenchPayloadSizes[p];
+			if (payloadLength > UART_BENCH_MAX_PAYLOAD) {
+				payloadLength = UART_BENCH_MAX_PAYLOAD;
+			}
+			sweepNs += uartWireNs(uartBenchBaudRates[b], payloadLength) + (uint64_t)UART_DEADLINE_MARGIN_MS * 1000000u;
+		}
+	}
+	return (uint32_t)(sweepNs * (uint64_t)numUARTs / 1000000u);
+}
+
+/// <summary>
+///     Ends the benchmark.  It only reports figures, so it always passes.
+/// </summary>
+static void uartBenchFinished(void) {
+
+	uartBenchRegistryDoneHandler(&uartBenchDescriptor, true);
+}
+
+/// <summary>
+///     Registry entry point for the benchmark.  The sweep runs on the epoll instance, one transfer after another, and
+///     doneHandler is called once it has finished.
+/// </summary>
+static bool uartBenchStart(int epollFd, TestDoneHandler doneHandler) {
 
-	//  If there are no uarts defined, then simply return a pass result.
 	if (numUARTs == 0) {
-		return testsPassed;
+		doneHandler(&uartBenchDescriptor, true);
+		return true;
 	}
 
+	uartEpollFd = epollFd;
+	uartBenchRegistryDoneHandler = doneHandler;
+	uartBenchmarkStart(&uartBenchFinished);
+	return true;
+}
+
+#endif // UART_BENCHMARK
+
+static TestDescriptor uartTestDescriptor;
+
+static TestDoneHandler uartRegistryDoneHandler = NULL;
+static struct timespec uartLoopbackStart;
+
+/// <summary>
+///     Checks and logs the outcome of each loopback once every transfer has finished, and reports the result.
+/// </summary>
+static void uartLoopbackDone(void) {
+
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	bool uartLoopbackPassed = true;
+
 	for (int i = 0; i < numUARTs; i++) {
+		const UartPortTest *port = &uartPorts[i];
+		long elapsedUs = (long)((port->end.tv_sec - port->start.tv_sec) * 1000000 + (port->end.tv_nsec - port->start.tv_nsec) / 1000);
 
-		if (!testUART((uartIDs[i]))) {
-			testsPassed = false;
+		if (port->done && port->passed) {
+			Log_Debug("TEST INFO: Uart test passed for ISU%d in %ld us\n", uartIDs[i] - MT3620_UART_ISU0, elapsedUs);
+		}
+		else {
+			Log_Debug("TEST FAILURE: UART test failed on ISU%d after %ld us\n", uartIDs[i] - MT3620_UART_ISU0, elapsedUs);
+			if (uartLoopbackPassed) {
+				TestRegistry_SetFailureIndex(&uartTestDescriptor, uartIDs[i] - MT3620_UART_ISU0);
+			}
+			uartLoopbackPassed = false;
 		}
 	}
 
-	return testsPassed;
+	Log_Debug("TEST INFO: UART loopback test of %d UARTs took %ld us\n", numUARTs,
+		(long)((end.tv_sec - uartLoopbackStart.tv_sec) * 1000000 + (end.tv_nsec - uartLoopbackStart.tv_nsec) / 1000));
+
+	uartRegistryDoneHandler(&uartTestDescriptor, uartLoopbackPassed);
+}
+
+static bool uartTestStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor uartTestDescriptor = { .name = "uart_loopback", .expectedMs = 50, .start = &uartTestStart,
+	.category = TestCategory_Uart };
+
+/// <summary>
+///     Registry entry point.  Opens the UARTs and returns; the transfers run on the epoll instance and doneHandler
+///     is called once every loopback has finished.
+/// </summary>
+static bool uartTestStart(int epollFd, TestDoneHandler doneHandler) {
+
+	//  If there are no uarts defined, then simply return a pass result.
+	if (numUARTs == 0) {
+		doneHandler(&uartTestDescriptor, true);
+		return true;
+	}
+
+	uartEpollFd = epollFd;
+	uartRegistryDoneHandler = doneHandler;
+	clock_gettime(CLOCK_MONOTONIC, &uartLoopbackStart);
 
+	startUartTransfers(uartIDs, numUARTs, (const uint8_t *)testString, strlen(testString), UART_TEST_BAUD_RATE, false,
+		&uartLoopbackDone);
+	return true;
 }
 
+void uartTestRegister(void) {
+
+	// The test claims the four pins of each ISU under test
+	for (int i = 0; i < numUARTs; i++) {
+		TestRegistry_AddUartPins(&uartTestDescriptor.resources, uartIDs[i] - MT3620_UART_ISU0);
+	}
+	TestRegistry_Register(&uartTestDescriptor);
+
+#ifdef UART_BENCHMARK
+	// The benchmark uses the same UARTs, so the scheduler runs it apart from the loopback test
+	uartBenchDescriptor.resources = uartTestDescriptor.resources;
+	uartBenchDescriptor.expectedMs = uartBenchmarkExpectedMs();
+	TestRegistry_Register(&uartBenchDescriptor);
+#endif
+}
+
+void uartTestClose(void) {
+
+	uartTransfersDoneHandler = NULL;
+	for (int i = 0; i < numUARTs; i++) {
+		Coroutine_Close(&uartCoroutines[i]);
+		if (uartPorts[i].opened) {
+			closeUartPort(&uartPorts[i]);
+		}
+	}
+}
@@ -1,5 +1,8 @@
 #pragma once
 
-// Function Declarations
-bool uartTestsPassed(void);
+// Asynchronous UART loopback test.  Starting the test opens every UART in uartIDs[] and returns at once; a coroutine per
+// UART on the epoll instance sends the test string and compares what comes back as it arrives.
+void uartTestClose(void);
 
+// Register the UART loopback test with the test registry
+void uartTestRegister(void);
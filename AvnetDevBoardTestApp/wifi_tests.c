@@ -2,12 +2,14 @@
 // applibs_versions.h defines the API struct versions to use for applibs APIs.
 #include "applibs_versions.h"
 #include "epoll_timerfd_utilities.h"
+#include "coroutine.h"
 
 #include <applibs/gpio.h>
 #include <applibs/log.h>
 #include <applibs/wificonfig.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <time.h>
@@ -18,6 +20,7 @@
 
 #include "platform.h"
 #include "gpio_tests.h"
+#include "test_registry.h"
 
 // Termination state
 extern sig_atomic_t terminationRequired;
@@ -27,6 +30,24 @@ const char *wifiKey = WIFI_KEY;
 static bool testedOnce = false;
 static bool staticTestResult;
 
+// Connection state.  The test runs as a coroutine, so these keep its state across the awaits.
+static coroutine_t wifiCoroutine;
+static int wifiEpollFd = -1;
+static bool wifiRunResult;
+static struct timespec wifiPollDelay;
+static struct timespec wifiStart;
+static void (*wifiDoneHandler)(bool passed) = NULL;
+
+/// <summary>
+///     Returns the milliseconds since the current test started.
+/// </summary>
+static long elapsedWifiMs(void) {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (long)((now.tv_sec - wifiStart.tv_sec) * 1000 + (now.tv_nsec - wifiStart.tv_nsec) / 1000000);
+}
+
 static bool IsWiFiConnected(void) {
 	WifiConfig_ConnectedNetwork network;
 	int result = WifiConfig_GetCurrentNetwork(&network);
@@ -37,10 +58,84 @@ static bool IsWiFiConnected(void) {
 		return true;
 	}
 }
-static bool DebugPrintScanFoundNetworks(void)
-{
-	bool returnValue = true;
-	float signalLevel = NAN;
+// Scan result cache.  The scanned networks are kept in a preallocated buffer with an open addressing index from
+// SSID hash to cache slot, so the target network is found without walking the list.
+#define WIFI_SCAN_CACHE_MAX_NETWORKS 32
+#define WIFI_SCAN_INDEX_SIZE 64
+
+static WifiConfig_ScannedNetwork scanCache[WIFI_SCAN_CACHE_MAX_NETWORKS];
+static int scanCacheCount = 0;
+static bool scanCacheValid = false;
+static struct timespec scanCacheTime;
+
+// Cache slot + 1 for each index entry, 0 marks an empty entry
+static uint8_t scanIndex[WIFI_SCAN_INDEX_SIZE];
+
+/// <summary>
+///     FNV-1a hash of an SSID.
+/// </summary>
+static uint32_t hashSsid(const uint8_t *ssid, size_t ssidLength) {
+
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < ssidLength; i++) {
+		hash = (hash ^ ssid[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/// <summary>
+///     Rebuilds the SSID index over the cached networks.
+/// </summary>
+static void indexScanCache(void) {
+
+	memset(scanIndex, 0, sizeof(scanIndex));
+	for (int i = 0; i < scanCacheCount; i++) {
+		uint32_t slot = hashSsid(scanCache[i].ssid, scanCache[i].ssidLength) & (WIFI_SCAN_INDEX_SIZE - 1);
+		while (scanIndex[slot] != 0) {
+			slot = (slot + 1) & (WIFI_SCAN_INDEX_SIZE - 1);
+		}
+		scanIndex[slot] = (uint8_t)(i + 1);
+	}
+}
+
+/// <summary>
+///     Looks an SSID up in the scan cache.
+/// </summary>
+/// <returns>The strongest cached network with that SSID, or NULL if the scan did not find it</returns>
+static const WifiConfig_ScannedNetwork *findScannedNetwork(const uint8_t *ssid, size_t ssidLength) {
+
+	const WifiConfig_ScannedNetwork *found = NULL;
+
+	uint32_t slot = hashSsid(ssid, ssidLength) & (WIFI_SCAN_INDEX_SIZE - 1);
+	while (scanIndex[slot] != 0) {
+		const WifiConfig_ScannedNetwork *network = &scanCache[scanIndex[slot] - 1];
+		if (network->ssidLength == ssidLength && memcmp(network->ssid, ssid, ssidLength) == 0 &&
+			(found == NULL || network->signalRssi > found->signalRssi)) {
+			found = network;
+		}
+		slot = (slot + 1) & (WIFI_SCAN_INDEX_SIZE - 1);
+	}
+	return found;
+}
+
+/// <summary>
+///     Fills the scan cache, reusing the last scan if it is less than WIFI_SCAN_CACHE_FRESH_MS old.
+/// </summary>
+/// <returns>The number of networks found, or -1 if the scan failed</returns>
+static int refreshScanCache(void) {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (scanCacheValid) {
+		long ageMs = (long)((now.tv_sec - scanCacheTime.tv_sec) * 1000 + (now.tv_nsec - scanCacheTime.tv_nsec) / 1000000);
+		if (ageMs < WIFI_SCAN_CACHE_FRESH_MS) {
+			Log_Debug("INFO: Reusing the WiFi scan from %ld ms ago.\n", ageMs);
+			return scanCacheCount;
+		}
+	}
+
+	scanCacheValid = false;
 
 	int result = WifiConfig_TriggerScanAndGetScannedNetworkCount();
 	if (result < 0) {
@@ -48,51 +143,63 @@ static bool DebugPrintScanFoundNetworks(void)
 			"ERROR: WifiConfig_TriggerScanAndGetScannedNetworkCount failed to get scanned "
 			"network count with result %d. Errno: %s (%d).\n",
 			result, strerror(errno), errno);
+		return -1;
 	}
-	else if (result == 0) {
-		Log_Debug("INFO: Scan found no WiFi network.\n");
+
+	size_t networkCount = (size_t)result;
+	if (networkCount > WIFI_SCAN_CACHE_MAX_NETWORKS) {
+		Log_Debug("INFO: Scan found %d WiFi networks, keeping the first %d.\n", result, WIFI_SCAN_CACHE_MAX_NETWORKS);
+		networkCount = WIFI_SCAN_CACHE_MAX_NETWORKS;
 	}
-	else {
-		size_t networkCount = (size_t)result;
-		Log_Debug("INFO: Scan found %d WiFi networks:\n", result);
-		WifiConfig_ScannedNetwork *networks =
-			(WifiConfig_ScannedNetwork *)malloc(sizeof(WifiConfig_ScannedNetwork) * networkCount);
-		result = WifiConfig_GetScannedNetworks(networks, networkCount);
-		if (result < 0) {
+
+	scanCacheCount = 0;
+	if (networkCount > 0) {
+		ssize_t got = WifiConfig_GetScannedNetworks(scanCache, networkCount);
+		if (got < 0) {
 			Log_Debug(
 				"ERROR: WifiConfig_GetScannedNetworks failed to get scanned networks with "
 				"result %d. Errno: %s (%d).\n",
-				result, strerror(errno), errno);
+				(int)got, strerror(errno), errno);
+			return -1;
 		}
-		else {
-			// Log SSID, signal strength and frequency of the found WiFi networks
-			networkCount = (size_t)result;
-			for (size_t i = 0; i < networkCount; ++i) {
-				Log_Debug("INFO: %3d) SSID \"%.*s\", Signal Level %d, Frequency %dMHz\n", i,
-					networks[i].ssidLength, networks[i].ssid, networks[i].signalRssi,
-					networks[i].frequencyMHz);
-
-				// Check to see if we've found our SSID and updated the signalLevel variable.  If not, keep looking.  If so, move on.
-				if (isnan(signalLevel)) {
-
-					bool stringsMatch = true;
-					for (int j = 0; j < networks[i].ssidLength; j++) {
-						if (networks[i].ssid[j] != WIFI_SSID[j]) {
-							stringsMatch = false;
-						}
-					}
-
-					// We found our ssid, capture the signalRssi.
-					if (stringsMatch) {
-						signalLevel = (float)networks[i].signalRssi;
-					}
-				}
-			}
+		scanCacheCount = (int)got;
+	}
+
+	indexScanCache();
+	scanCacheTime = now;
+	scanCacheValid = true;
+	return scanCacheCount;
+}
+
+static bool DebugPrintScanFoundNetworks(void)
+{
+	bool returnValue = true;
+	float signalLevel = NAN;
+
+	int result = refreshScanCache();
+	if (result == 0) {
+		Log_Debug("INFO: Scan found no WiFi network.\n");
+	}
+	else if (result > 0) {
+		Log_Debug("INFO: Scan found %d WiFi networks\n", result);
+
+#ifdef SHOW_DEBUG
+		// Log SSID, signal strength and frequency of the found WiFi networks
+		for (int i = 0; i < scanCacheCount; ++i) {
+			Log_Debug("INFO: %3d) SSID \"%.*s\", Signal Level %d, Frequency %dMHz\n", i,
+				scanCache[i].ssidLength, scanCache[i].ssid, scanCache[i].signalRssi,
+				scanCache[i].frequencyMHz);
+		}
+#endif
+
+		// Look our SSID up and capture its signalRssi
+		const WifiConfig_ScannedNetwork *network = findScannedNetwork((const uint8_t *)WIFI_SSID, strlen(WIFI_SSID));
+		if (network != NULL) {
+			signalLevel = (float)network->signalRssi;
+			Log_Debug("INFO: SSID \"%s\", Signal Level %d, Frequency %dMHz\n", WIFI_SSID, network->signalRssi, network->frequencyMHz);
 		}
-		
-		free(networks);
 	}
-	
+
 	// Check to see if our signal level is acceptable.  
 	if (signalLevel < MINIMUM_WIFI_SIGNAL_STRENGTH) {
 		Log_Debug("TEST FAILURE: Signal Level is below minimum!  Signal Level: %.0f, Minimum Level: %.0f\n", signalLevel, MINIMUM_WIFI_SIGNAL_STRENGTH);
@@ -127,22 +234,52 @@ static void DebugPrintCurrentlyConnectedWiFiNetwork(void)
 	}
 }
 
-bool wifiTestsPassed(void){
+/// <summary>
+///     Scans for networks, forgets the stored network and reports the result of this run.
+/// </summary>
+static void finishWifiTest(void) {
+
+	// Scan for networks, if we don't find any, then fail the test.
+	if (!DebugPrintScanFoundNetworks()) {
+		wifiRunResult = false;
+	}
 
-	int wifiResult = 0;
-	static 	bool testsResult = true;
+	int wifiResult = WifiConfig_ForgetAllNetworks();
 
-	if (RUN_WIFI_TESTS_ONCE) {
-		if (testedOnce) {
-			Log_Debug("TEST INFO: Wifi tests not run again!  First pass test result was \"wifi testing %s.\"\n", testsResult ? "passed" : "failed");
-			return staticTestResult;
-		}
+	if (wifiResult < 0) {
+		Log_Debug("ERROR: WifiConfig_ForgetAllNetworks failed to remove all stored networks. result %d. Errno: %s (%d).\n",
+			wifiResult, strerror(errno), errno);
+	}
+	else {
+		Log_Debug("TEST INFO: Successfully removed all WiFi networks\n");
 	}
 
-	// Set the flag that says we've tested the wifi stuff once.
-	testedOnce = true;
-	
-	wifiResult = WifiConfig_StoreWpa2Network((uint8_t*)wifiSsid, strlen(wifiSsid), wifiKey, strlen(wifiKey));
+	Log_Debug("TEST INFO: Wifi test took %ld ms\n", elapsedWifiMs());
+
+	staticTestResult = wifiRunResult;
+}
+
+/// <summary>
+///     Sets the delay before the next connection check.
+/// </summary>
+static void setWifiPollDelay(long milliseconds) {
+
+	wifiPollDelay.tv_sec = milliseconds / 1000;
+	wifiPollDelay.tv_nsec = (milliseconds % 1000) * 1000000;
+}
+
+/// <summary>
+///     The wifi test: store the network, wait for the connection with a growing delay between checks, then scan and
+///     forget the network.  Written as a coroutine, so the event loop keeps running during every wait.
+/// </summary>
+static int wifiTestBody(coroutine_t *co) {
+
+	CO_BEGIN(co);
+
+	wifiRunResult = true;
+	clock_gettime(CLOCK_MONOTONIC, &wifiStart);
+
+	int wifiResult = WifiConfig_StoreWpa2Network((uint8_t*)wifiSsid, strlen(wifiSsid), wifiKey, strlen(wifiKey));
 
 	if (wifiResult < 0) {
 		if (errno == EEXIST) {
@@ -153,7 +290,7 @@ bool wifiTestsPassed(void){
 				"TEST FAILURE: WifiConfig_StoreOpenNetwork failed to store WiFi network \"%s\" with "
 				"result %d. Errno: %s (%d).\n",
 				wifiSsid, wifiResult, strerror(errno), errno);
-			testsResult = false;
+			wifiRunResult = false;
 		}
 	}
 	
@@ -161,41 +298,111 @@ bool wifiTestsPassed(void){
 		Log_Debug("TEST INFO: Successfully stored WiFi network: \"%s\".\n", wifiSsid);
 	}
 
-	// Loop for 45 seconds to try and connect to the wifi access point
+	// Check the connection until connected or WIFI_CONNECT_TIMEOUT_MS has passed
+	Log_Debug("TEST INFO: connecting to network . . .\n");
+	setWifiPollDelay(WIFI_CONNECT_POLL_MIN_MS);
+	for (;;) {
+		CO_AWAIT_DELAY(co, &wifiPollDelay);
 
-	int loopCnt = 45;
-	
-	do {
-		sleep(1);
-		Log_Debug("TEST INFO: connecting to network . . .\n");
-	} while (!IsWiFiConnected() & (loopCnt-- > 0));
+		if (IsWiFiConnected()) {
+			Log_Debug("TEST INFO: Connected to network in %ld ms!\n", elapsedWifiMs());
 
-	if (loopCnt <= 0) {
-		testsResult = false;
-	}
-	else {
-		Log_Debug("TEST INFO: Connected to network!\n");
-	
-		// Print the currently connected network.
-		DebugPrintCurrentlyConnectedWiFiNetwork();
+			// Print the currently connected network.
+			DebugPrintCurrentlyConnectedWiFiNetwork();
+			break;
+		}
+
+		if (elapsedWifiMs() >= WIFI_CONNECT_TIMEOUT_MS) {
+			Log_Debug("TEST FAILURE: Not connected to network after %ld ms\n", elapsedWifiMs());
+			wifiRunResult = false;
+			break;
+		}
+
+		// Back off: each check waits twice as long as the last, up to WIFI_CONNECT_POLL_MAX_MS
+		long pollMs = (long)wifiPollDelay.tv_sec * 1000 + wifiPollDelay.tv_nsec / 1000000;
+		setWifiPollDelay(pollMs * 2 < WIFI_CONNECT_POLL_MAX_MS ? pollMs * 2 : WIFI_CONNECT_POLL_MAX_MS);
 	}
 
-	// Scan for networks, if we don't find any, then fail the test.
-	if (!DebugPrintScanFoundNetworks()) {
-		testsResult = false;
+	finishWifiTest();
+
+	CO_END(co);
+}
+
+/// <summary>
+///     Reports the result once the wifi test coroutine has finished.
+/// </summary>
+static void wifiTestDone(coroutine_t *co) {
+
+	if (wifiDoneHandler != NULL) {
+		wifiDoneHandler(wifiRunResult);
 	}
+}
 
-	wifiResult = WifiConfig_ForgetAllNetworks();
+bool wifiTestInit(int epollFd) {
 
-	if (wifiResult < 0) {
-		Log_Debug("ERROR: WifiConfig_ForgetAllNetworks failed to remove all stored networks. result %d. Errno: %s (%d).\n",
-			wifiResult, strerror(errno), errno);
+	wifiEpollFd = epollFd;
+	return true;
+}
+
+void wifiTestStart(void (*doneHandler)(bool passed)) {
+
+	wifiDoneHandler = doneHandler;
+
+	if (RUN_WIFI_TESTS_ONCE) {
+		if (testedOnce) {
+			Log_Debug("TEST INFO: Wifi tests not run again!  First pass test result was \"wifi testing %s.\"\n", staticTestResult ? "passed" : "failed");
+			if (wifiDoneHandler != NULL) {
+				wifiDoneHandler(staticTestResult);
+			}
+			return;
+		}
 	}
-	else {
-		Log_Debug("TEST INFO: Successfully removed all WiFi networks\n");
+
+	// Set the flag that says we've tested the wifi stuff once.
+	testedOnce = true;
+
+	// A test that is already connecting is abandoned and restarted
+	if (Coroutine_Start(&wifiCoroutine, wifiEpollFd, &wifiTestBody, &wifiTestDone, NULL) != 0) {
+		terminationRequired = true;
 	}
-	
-	staticTestResult = testsResult;
-	return testsResult;
 }
 
+bool wifiTestRunning(void) {
+
+	return Coroutine_Running(&wifiCoroutine);
+}
+
+void wifiTestClose(void) {
+
+	Coroutine_Close(&wifiCoroutine);
+}
+
+static bool wifiRegistryStart(int epollFd, TestDoneHandler doneHandler);
+
+static TestDescriptor wifiTestDescriptor = { .name = "wifi", .expectedMs = 3000, .start = &wifiRegistryStart,
+	.resources = { .flags = TEST_RESOURCE_WIFI }, .category = TestCategory_Wifi };
+
+static TestDoneHandler wifiRegistryDoneHandler = NULL;
+
+/// <summary>
+///     Passes the end of the wifi test on to the registry.
+/// </summary>
+static void wifiRegistryDone(bool passed) {
+
+	wifiRegistryDoneHandler(&wifiTestDescriptor, passed);
+}
+
+/// <summary>
+///     Registry entry point.  The test connects in the background and reports when it has finished.
+/// </summary>
+static bool wifiRegistryStart(int epollFd, TestDoneHandler doneHandler) {
+
+	wifiRegistryDoneHandler = doneHandler;
+	wifiTestStart(&wifiRegistryDone);
+	return true;
+}
+
+void wifiTestRegister(void) {
+
+	TestRegistry_Register(&wifiTestDescriptor);
+}
@@ -1,3 +1,11 @@
 #pragma once
 
-bool wifiTestsPassed(void);
+// Asynchronous wifi test.  Starting the test stores the network and returns at once; a coroutine on the epoll instance
+// checks the connection with backoff, then scans and calls doneHandler with the result.
+bool wifiTestInit(int epollFd);
+void wifiTestStart(void (*doneHandler)(bool passed));
+bool wifiTestRunning(void);
+void wifiTestClose(void);
+
+// Register the wifi test with the test registry
+void wifiTestRegister(void);
@@ -0,0 +1,20 @@
+/// Host stand-in for the Azure Sphere applibs logging API. Debug output goes to stderr so it does
+/// not interleave with the tables the host tools print on stdout.
+#pragma once
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static inline int Log_DebugVarArgs(const char *fmt, va_list args)
+{
+    return vfprintf(stderr, fmt, args);
+}
+
+static inline int Log_Debug(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int result = Log_DebugVarArgs(fmt, args);
+    va_end(args);
+    return result;
+}
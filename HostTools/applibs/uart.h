@@ -0,0 +1,53 @@
+/// Host stand-in for the Azure Sphere applibs UART API, implemented by applibs_sim.c.
+#pragma once
+
+#include <stdint.h>
+
+typedef int UART_Id;
+typedef uint32_t UART_BaudRate_Type;
+
+typedef enum {
+    UART_BlockingMode_NonBlocking = 0
+} UART_BlockingMode;
+typedef uint8_t UART_BlockingMode_Type;
+
+typedef enum {
+    UART_DataBits_Five = 0,
+    UART_DataBits_Six = 1,
+    UART_DataBits_Seven = 2,
+    UART_DataBits_Eight = 3
+} UART_DataBits;
+typedef uint8_t UART_DataBits_Type;
+
+typedef enum {
+    UART_Parity_None = 0,
+    UART_Parity_Even = 1,
+    UART_Parity_Odd = 2
+} UART_Parity;
+typedef uint8_t UART_Parity_Type;
+
+typedef enum {
+    UART_StopBits_One = 1,
+    UART_StopBits_Two = 2
+} UART_StopBits;
+typedef uint8_t UART_StopBits_Type;
+
+typedef enum {
+    UART_FlowControl_None = 0,
+    UART_FlowControl_RTSCTS = 1,
+    UART_FlowControl_XONXOFF = 2
+} UART_FlowControl;
+typedef uint8_t UART_FlowControl_Type;
+
+typedef struct UART_Config {
+    uint32_t z__magicAndVersion;
+    UART_BaudRate_Type baudRate;
+    UART_BlockingMode_Type blockingMode;
+    UART_DataBits_Type dataBits;
+    UART_Parity_Type parity;
+    UART_StopBits_Type stopBits;
+    UART_FlowControl_Type flowControl;
+} UART_Config;
+
+void UART_InitConfig(UART_Config *uartConfig);
+int UART_Open(UART_Id uartId, const UART_Config *uartConfig);
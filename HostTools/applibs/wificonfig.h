@@ -0,0 +1,46 @@
+/// Host stand-in for the Azure Sphere applibs WifiConfig API, implemented by applibs_sim.c.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define WIFICONFIG_SSID_MAX_LENGTH 32
+#define WIFICONFIG_WPA2_KEY_MAX_BUFFER_SIZE 64
+#define WIFICONFIG_BSSID_BUFFER_SIZE 6
+
+typedef enum {
+    WifiConfig_Security_Unknown = 0,
+    WifiConfig_Security_Open = 1,
+    WifiConfig_Security_Wpa2_Psk = 2
+} WifiConfig_Security;
+typedef uint8_t WifiConfig_Security_Type;
+
+typedef struct WifiConfig_ConnectedNetwork {
+    uint32_t z__magicAndVersion;
+    uint8_t ssid[WIFICONFIG_SSID_MAX_LENGTH];
+    uint8_t bssid[WIFICONFIG_BSSID_BUFFER_SIZE];
+    uint8_t ssidLength;
+    WifiConfig_Security_Type security;
+    uint32_t frequencyMHz;
+    int8_t signalRssi;
+} WifiConfig_ConnectedNetwork;
+
+typedef struct WifiConfig_ScannedNetwork {
+    uint32_t z__magicAndVersion;
+    uint8_t ssid[WIFICONFIG_SSID_MAX_LENGTH];
+    uint8_t bssid[WIFICONFIG_BSSID_BUFFER_SIZE];
+    uint8_t ssidLength;
+    WifiConfig_Security_Type security;
+    uint32_t frequencyMHz;
+    int8_t signalRssi;
+} WifiConfig_ScannedNetwork;
+
+int WifiConfig_StoreOpenNetwork(const uint8_t *ssid, size_t ssidLength);
+int WifiConfig_StoreWpa2Network(const uint8_t *ssid, size_t ssidLength, const char *psk,
+                                size_t pskLength);
+int WifiConfig_ForgetAllNetworks(void);
+int WifiConfig_GetCurrentNetwork(WifiConfig_ConnectedNetwork *connectedNetwork);
+int WifiConfig_TriggerScanAndGetScannedNetworkCount(void);
+ssize_t WifiConfig_GetScannedNetworks(WifiConfig_ScannedNetwork *scannedNetworkArray,
+                                      size_t scannedNetworkArrayCount);
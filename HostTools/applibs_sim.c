@@ -0,0 +1,548 @@
+/// Host-side implementation of the applibs GPIO, UART and WifiConfig entry points used by the
+/// test application, so the full test suite can be run and profiled on a Linux workstation.
+///
+///  - GPIO pins live in a POSIX shared-memory segment (see mt3620sim.h). Jumper wiring between
+///    pins is declared in the configuration file; mt3620sim_ctl can force pins from outside.
+///  - UARTs are pty pairs. A UART listed as loopback has echo enabled on the slave side, so bytes
+///    written to the UART come back on the same fd; other UARTs print their /dev/pts path.
+///  - WiFi is a fake scan table; stored networks connect after a configurable delay.
+///  - Every call can be given a per-call latency to model the device and measure cycle time.
+///
+/// The configuration file is read from $MT3620SIM_CONFIG, or ./mt3620sim.conf if present. See
+/// HostTools/mt3620sim.conf for the syntax. Call counts and simulated latency are printed to
+/// stderr when the application exits.
+///
+/// Build the test application for the host from the repository root:
+///     gcc -O2 -IHostTools -IAvnetDevBoardTestApp -o avnet_test_host
+///         AvnetDevBoardTestApp/*.c HostTools/applibs_sim.c -lm -lrt
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <applibs/gpio.h>
+#include <applibs/log.h>
+#include <applibs/uart.h>
+#include <applibs/wificonfig.h>
+
+#include "mt3620sim.h"
+
+#define SIM_MAX_FDS 1024
+#define SIM_MAX_UARTS 16
+#define SIM_MAX_NETWORKS 32
+#define SIM_MAX_STORED_NETWORKS 8
+
+typedef enum {
+    SimFd_None = 0,
+    SimFd_GpioInput,
+    SimFd_GpioOutput,
+    SimFd_Uart
+} SimFdKind;
+
+typedef struct {
+    SimFdKind kind;
+    int pin;
+    ino_t inode;
+    int uartSlaveFd;
+    char ptsName[64];
+} SimFd;
+
+typedef enum {
+    SimCall_Gpio = 0,
+    SimCall_Uart,
+    SimCall_Wifi,
+    SimCall_Count
+} SimCallClass;
+
+static const char *callClassNames[SimCall_Count] = {"gpio", "uart", "wifi"};
+
+static bool initialized = false;
+static mt3620sim_shared_t *shared = NULL;
+static SimFd fdTable[SIM_MAX_FDS];
+
+static long callLatencyUs[SimCall_Count];
+static unsigned long callCounts[SimCall_Count];
+static unsigned long gpioOpens, gpioSets, gpioGets, uartOpens;
+
+static bool uartLoopback[SIM_MAX_UARTS];
+
+static WifiConfig_ScannedNetwork scanTable[SIM_MAX_NETWORKS];
+static size_t scanTableCount = 0;
+static long wifiConnectDelayMs = 2000;
+static long wifiScanMs = 0;
+static char storedSsids[SIM_MAX_STORED_NETWORKS][WIFICONFIG_SSID_MAX_LENGTH + 1];
+static size_t storedCount = 0;
+static struct timespec lastStoreTime;
+
+static long long ElapsedMs(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)(now.tv_sec - since->tv_sec) * 1000 +
+           (now.tv_nsec - since->tv_nsec) / 1000000;
+}
+
+static void SleepUs(long us)
+{
+    if (us <= 0) {
+        return;
+    }
+    struct timespec ts = {.tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000};
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+static void SimulateCall(SimCallClass callClass)
+{
+    callCounts[callClass]++;
+    SleepUs(callLatencyUs[callClass]);
+}
+
+static void PrintSimulatorStats(void)
+{
+    fprintf(stderr, "SIM: gpio opens %lu, sets %lu, gets %lu; uart opens %lu\n", gpioOpens,
+            gpioSets, gpioGets, uartOpens);
+    for (int i = 0; i < SimCall_Count; i++) {
+        fprintf(stderr, "SIM: %s calls %lu, simulated latency %.3f ms\n", callClassNames[i],
+                callCounts[i], (double)callCounts[i] * (double)callLatencyUs[i] / 1000.0);
+    }
+}
+
+static int ParseUartId(const char *token)
+{
+    if (strncasecmp(token, "ISU", 3) == 0) {
+        return 4 + atoi(token + 3);
+    }
+    return atoi(token);
+}
+
+static void AddScannedNetwork(const char *ssid, int rssi, unsigned frequencyMHz)
+{
+    if (scanTableCount >= SIM_MAX_NETWORKS) {
+        fprintf(stderr, "SIM: ignoring network \"%s\", scan table is full\n", ssid);
+        return;
+    }
+    WifiConfig_ScannedNetwork *network = &scanTable[scanTableCount];
+    memset(network, 0, sizeof(*network));
+    network->ssidLength = (uint8_t)strnlen(ssid, WIFICONFIG_SSID_MAX_LENGTH);
+    memcpy(network->ssid, ssid, network->ssidLength);
+    for (int i = 0; i < WIFICONFIG_BSSID_BUFFER_SIZE; i++) {
+        network->bssid[i] = (uint8_t)(0x02 + i * 0x11 + scanTableCount);
+    }
+    network->security = WifiConfig_Security_Wpa2_Psk;
+    network->signalRssi = (int8_t)rssi;
+    network->frequencyMHz = frequencyMHz;
+    scanTableCount++;
+}
+
+static void LoadConfiguration(void)
+{
+    const char *path = getenv("MT3620SIM_CONFIG");
+    if (path == NULL) {
+        path = "mt3620sim.conf";
+        if (access(path, R_OK) != 0) {
+            return;
+        }
+    }
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "SIM: cannot open configuration %s: %s\n", path, strerror(errno));
+        return;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        char key[32], arg1[64], arg2[64], arg3[64];
+        int fields = sscanf(line, "%31s %63s %63s %63s", key, arg1, arg2, arg3);
+        if (fields <= 0) {
+            continue;
+        }
+
+        if (strcmp(key, "wire") == 0 && fields == 3) {
+            int a = atoi(arg1);
+            int b = atoi(arg2);
+            if (a < 0 || b < 0 || a >= MT3620SIM_GPIO_COUNT || b >= MT3620SIM_GPIO_COUNT) {
+                fprintf(stderr, "SIM: %s:%d: pin out of range\n", path, lineNumber);
+                continue;
+            }
+            shared->pins[a].wire = (int16_t)b;
+            shared->pins[b].wire = (int16_t)a;
+        } else if (strcmp(key, "uart_loopback") == 0 && fields == 2) {
+            int id = ParseUartId(arg1);
+            if (id >= 0 && id < SIM_MAX_UARTS) {
+                uartLoopback[id] = true;
+            }
+        } else if (strcmp(key, "wifi_network") == 0 && fields == 4) {
+            AddScannedNetwork(arg1, atoi(arg2), (unsigned)atoi(arg3));
+        } else if (strcmp(key, "wifi_connect_ms") == 0 && fields == 2) {
+            wifiConnectDelayMs = atol(arg1);
+        } else if (strcmp(key, "wifi_scan_ms") == 0 && fields == 2) {
+            wifiScanMs = atol(arg1);
+        } else if (strcmp(key, "latency_us") == 0 && fields == 3) {
+            for (int i = 0; i < SimCall_Count; i++) {
+                if (strcmp(arg1, callClassNames[i]) == 0) {
+                    callLatencyUs[i] = atol(arg2);
+                }
+            }
+        } else {
+            fprintf(stderr, "SIM: %s:%d: unrecognized line\n", path, lineNumber);
+        }
+    }
+
+    fclose(file);
+}
+
+static void SimInit(void)
+{
+    if (initialized) {
+        return;
+    }
+    initialized = true;
+
+    const char *shmName = getenv("MT3620SIM_SHM");
+    if (shmName == NULL) {
+        shmName = MT3620SIM_SHM_DEFAULT_NAME;
+    }
+
+    int shmFd = shm_open(shmName, O_CREAT | O_RDWR, 0600);
+    if (shmFd < 0 || ftruncate(shmFd, sizeof(mt3620sim_shared_t)) != 0) {
+        fprintf(stderr, "SIM: cannot create shared memory %s: %s\n", shmName, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    shared = mmap(NULL, sizeof(mt3620sim_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    close(shmFd);
+    if (shared == MAP_FAILED) {
+        fprintf(stderr, "SIM: cannot map shared memory: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    // A new application run starts from released pins and fresh wiring.
+    memset(shared, 0, sizeof(*shared));
+    for (int i = 0; i < MT3620SIM_GPIO_COUNT; i++) {
+        shared->pins[i].wire = MT3620SIM_NO_WIRE;
+    }
+    shared->ownerPid = (uint32_t)getpid();
+    shared->magic = MT3620SIM_MAGIC;
+
+    for (int i = 0; i < SIM_MAX_FDS; i++) {
+        fdTable[i].uartSlaveFd = -1;
+    }
+
+    LoadConfiguration();
+    atexit(PrintSimulatorStats);
+}
+
+/// <summary>
+///     Checks that a tracked fd is still the one the simulator handed out; the application
+///     closes fds with close(), so a closed or reused number must be detected here.
+/// </summary>
+static bool SimFdIsLive(int fd)
+{
+    SimFd *entry = &fdTable[fd];
+    if (entry->kind == SimFd_Uart) {
+        char name[64];
+        return ptsname_r(fd, name, sizeof(name)) == 0 && strcmp(name, entry->ptsName) == 0;
+    }
+
+    struct stat st;
+    return fstat(fd, &st) == 0 && st.st_ino == entry->inode;
+}
+
+static void SimFdRelease(int fd)
+{
+    SimFd *entry = &fdTable[fd];
+    if (entry->kind == SimFd_GpioOutput) {
+        shared->pins[entry->pin].driven = 0;
+    } else if (entry->kind == SimFd_Uart && entry->uartSlaveFd >= 0) {
+        close(entry->uartSlaveFd);
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->uartSlaveFd = -1;
+}
+
+/// <summary>
+///     Drops the entries of fds the application has closed since the last open.
+/// </summary>
+static void SimFdSweep(void)
+{
+    for (int fd = 0; fd < SIM_MAX_FDS; fd++) {
+        if (fdTable[fd].kind != SimFd_None && !SimFdIsLive(fd)) {
+            SimFdRelease(fd);
+        }
+    }
+}
+
+static SimFd *SimFdLookup(int fd, SimFdKind kind1, SimFdKind kind2)
+{
+    if (fd < 0 || fd >= SIM_MAX_FDS ||
+        (fdTable[fd].kind != kind1 && fdTable[fd].kind != kind2) || !SimFdIsLive(fd)) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &fdTable[fd];
+}
+
+static int OpenGpio(GPIO_Id gpioId, SimFdKind kind)
+{
+    SimInit();
+    SimulateCall(SimCall_Gpio);
+    gpioOpens++;
+
+    if (gpioId < 0 || gpioId >= MT3620SIM_GPIO_COUNT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    SimFdSweep();
+    for (int fd = 0; fd < SIM_MAX_FDS; fd++) {
+        if ((fdTable[fd].kind == SimFd_GpioInput || fdTable[fd].kind == SimFd_GpioOutput) &&
+            fdTable[fd].pin == gpioId) {
+            errno = EBUSY;
+            return -1;
+        }
+    }
+
+    // Each GPIO handle is a distinct memfd so the simulator can tell when it has been closed.
+    int fd = memfd_create("mt3620sim-gpio", MFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fd >= SIM_MAX_FDS) {
+        close(fd);
+        errno = EMFILE;
+        return -1;
+    }
+
+    struct stat st;
+    fstat(fd, &st);
+    fdTable[fd].kind = kind;
+    fdTable[fd].pin = gpioId;
+    fdTable[fd].inode = st.st_ino;
+    return fd;
+}
+
+int GPIO_OpenAsOutput(GPIO_Id gpioId, GPIO_OutputMode_Type outputMode,
+                      GPIO_Value_Type initialValue)
+{
+    (void)outputMode;
+    int fd = OpenGpio(gpioId, SimFd_GpioOutput);
+    if (fd >= 0) {
+        shared->pins[gpioId].outputLevel = initialValue ? 1 : 0;
+        shared->pins[gpioId].driven = 1;
+    }
+    return fd;
+}
+
+int GPIO_OpenAsInput(GPIO_Id gpioId)
+{
+    return OpenGpio(gpioId, SimFd_GpioInput);
+}
+
+int GPIO_SetValue(int gpioFd, GPIO_Value_Type value)
+{
+    SimInit();
+    SimulateCall(SimCall_Gpio);
+    gpioSets++;
+
+    SimFd *entry = SimFdLookup(gpioFd, SimFd_GpioOutput, SimFd_GpioOutput);
+    if (entry == NULL) {
+        return -1;
+    }
+    shared->pins[entry->pin].outputLevel = value ? 1 : 0;
+    return 0;
+}
+
+int GPIO_GetValue(int gpioFd, GPIO_Value_Type *outValue)
+{
+    SimInit();
+    SimulateCall(SimCall_Gpio);
+    gpioGets++;
+
+    SimFd *entry = SimFdLookup(gpioFd, SimFd_GpioInput, SimFd_GpioOutput);
+    if (entry == NULL) {
+        return -1;
+    }
+    *outValue = Mt3620Sim_ResolveLevel(shared, entry->pin);
+    return 0;
+}
+
+void UART_InitConfig(UART_Config *uartConfig)
+{
+    memset(uartConfig, 0, sizeof(*uartConfig));
+    uartConfig->baudRate = 9600;
+    uartConfig->blockingMode = UART_BlockingMode_NonBlocking;
+    uartConfig->dataBits = UART_DataBits_Eight;
+    uartConfig->parity = UART_Parity_None;
+    uartConfig->stopBits = UART_StopBits_One;
+    uartConfig->flowControl = UART_FlowControl_None;
+}
+
+int UART_Open(UART_Id uartId, const UART_Config *uartConfig)
+{
+    (void)uartConfig;
+    SimInit();
+    SimulateCall(SimCall_Uart);
+    uartOpens++;
+
+    if (uartId < 0 || uartId >= SIM_MAX_UARTS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    SimFdSweep();
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        return -1;
+    }
+    if (master >= SIM_MAX_FDS) {
+        close(master);
+        errno = EMFILE;
+        return -1;
+    }
+
+    SimFd *entry = &fdTable[master];
+    ptsname_r(master, entry->ptsName, sizeof(entry->ptsName));
+    entry->uartSlaveFd = open(entry->ptsName, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (entry->uartSlaveFd < 0) {
+        close(master);
+        return -1;
+    }
+
+    // Raw 8-bit line; echo on the slave side turns the pty into a TX->RX loopback.
+    struct termios tio;
+    tcgetattr(entry->uartSlaveFd, &tio);
+    cfmakeraw(&tio);
+    if (uartLoopback[uartId]) {
+        // Without ECHOCTL control bytes would come back as two-byte ^X sequences
+        tio.c_lflag |= ECHO;
+        tio.c_lflag &= ~(tcflag_t)(ECHOCTL | ECHOKE | ECHOE | ECHOK | ECHONL);
+    }
+    tcsetattr(entry->uartSlaveFd, TCSANOW, &tio);
+
+    entry->kind = SimFd_Uart;
+    entry->pin = uartId;
+    if (!uartLoopback[uartId]) {
+        fprintf(stderr, "SIM: UART %d is %s\n", uartId, entry->ptsName);
+    }
+    return master;
+}
+
+static bool IsStored(const uint8_t *ssid, size_t ssidLength)
+{
+    for (size_t i = 0; i < storedCount; i++) {
+        if (strlen(storedSsids[i]) == ssidLength &&
+            memcmp(storedSsids[i], ssid, ssidLength) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int StoreNetwork(const uint8_t *ssid, size_t ssidLength)
+{
+    SimInit();
+    SimulateCall(SimCall_Wifi);
+
+    if (ssidLength == 0 || ssidLength > WIFICONFIG_SSID_MAX_LENGTH) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (IsStored(ssid, ssidLength)) {
+        errno = EEXIST;
+        return -1;
+    }
+    if (storedCount >= SIM_MAX_STORED_NETWORKS) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    memcpy(storedSsids[storedCount], ssid, ssidLength);
+    storedSsids[storedCount][ssidLength] = '\0';
+    storedCount++;
+    clock_gettime(CLOCK_MONOTONIC, &lastStoreTime);
+    return 0;
+}
+
+int WifiConfig_StoreOpenNetwork(const uint8_t *ssid, size_t ssidLength)
+{
+    return StoreNetwork(ssid, ssidLength);
+}
+
+int WifiConfig_StoreWpa2Network(const uint8_t *ssid, size_t ssidLength, const char *psk,
+                                size_t pskLength)
+{
+    (void)psk;
+    (void)pskLength;
+    return StoreNetwork(ssid, ssidLength);
+}
+
+int WifiConfig_ForgetAllNetworks(void)
+{
+    SimInit();
+    SimulateCall(SimCall_Wifi);
+    storedCount = 0;
+    return 0;
+}
+
+int WifiConfig_GetCurrentNetwork(WifiConfig_ConnectedNetwork *connectedNetwork)
+{
+    SimInit();
+    SimulateCall(SimCall_Wifi);
+
+    if (storedCount > 0 && ElapsedMs(&lastStoreTime) >= wifiConnectDelayMs) {
+        for (size_t i = 0; i < scanTableCount; i++) {
+            if (IsStored(scanTable[i].ssid, scanTable[i].ssidLength)) {
+                memset(connectedNetwork, 0, sizeof(*connectedNetwork));
+                memcpy(connectedNetwork->ssid, scanTable[i].ssid, scanTable[i].ssidLength);
+                memcpy(connectedNetwork->bssid, scanTable[i].bssid,
+                       WIFICONFIG_BSSID_BUFFER_SIZE);
+                connectedNetwork->ssidLength = scanTable[i].ssidLength;
+                connectedNetwork->security = scanTable[i].security;
+                connectedNetwork->frequencyMHz = scanTable[i].frequencyMHz;
+                connectedNetwork->signalRssi = scanTable[i].signalRssi;
+                return 0;
+            }
+        }
+    }
+
+    errno = ENOTCONN;
+    return -1;
+}
+
+int WifiConfig_TriggerScanAndGetScannedNetworkCount(void)
+{
+    SimInit();
+    SimulateCall(SimCall_Wifi);
+    SleepUs(wifiScanMs * 1000);
+    return (int)scanTableCount;
+}
+
+ssize_t WifiConfig_GetScannedNetworks(WifiConfig_ScannedNetwork *scannedNetworkArray,
+                                      size_t scannedNetworkArrayCount)
+{
+    SimInit();
+    SimulateCall(SimCall_Wifi);
+
+    size_t count = scanTableCount < scannedNetworkArrayCount ? scanTableCount
+                                                               : scannedNetworkArrayCount;
+    memcpy(scannedNetworkArray, scanTable, count * sizeof(*scanTable));
+    return (ssize_t)count;
+}
@@ -0,0 +1,127 @@
+/// Decodes the binary log records that the test application dumps with BINLOG_RAW defined in
+/// platform.h back into text.
+///
+///     binlog_decode [log-file]
+///
+/// The log is the application's debug output, read from stdin when no file is given. Each
+/// "BINLOG: " hex line is replaced by its message, prefixed with the time in seconds since the
+/// first record; every other line is copied unchanged. The formats come from
+/// AvnetDevBoardTestApp/binlog_formats.h, so decode with a build of the same source as the device.
+///
+/// Build from the repository root:
+///     gcc -O2 -IAvnetDevBoardTestApp -o binlog_decode HostTools/binlog_decode.c
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "binlog_formats.h"
+
+// Record layout, see BinLog_Record in AvnetDevBoardTestApp/binlog.h
+#define BINLOG_RECORD_BYTES 32
+#define BINLOG_MAX_ARGS 6
+
+#define LINE_MAX_CHARS 1024
+
+static const char *const formats[] = {
+#define BINLOG_FORMAT_STRING(id, format) format,
+    BINLOG_FORMATS(BINLOG_FORMAT_STRING)
+#undef BINLOG_FORMAT_STRING
+};
+
+static uint32_t GetWord(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) |
+           ((uint32_t)bytes[3] << 24);
+}
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// Decodes the hex of a "BINLOG: " line into a record. Returns 0 on success, or -1 if the line is
+/// not a complete record.
+static int DecodeLine(const char *line, uint8_t *bytes)
+{
+    const char *hex = strstr(line, "BINLOG: ");
+    if (hex == NULL) {
+        return -1;
+    }
+    hex += strlen("BINLOG: ");
+
+    for (size_t i = 0; i < BINLOG_RECORD_BYTES; i++) {
+        int high = HexDigit(hex[2 * i]);
+        int low = (high < 0) ? -1 : HexDigit(hex[2 * i + 1]);
+        if (low < 0) {
+            return -1;
+        }
+        bytes[i] = (uint8_t)(high << 4 | low);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *log = stdin;
+    if (argc >= 2 && (log = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    char line[LINE_MAX_CHARS];
+    uint8_t bytes[BINLOG_RECORD_BYTES];
+    int haveFirst = 0;
+    uint32_t firstUs = 0;
+    unsigned records = 0;
+    unsigned unknown = 0;
+
+    while (fgets(line, sizeof(line), log) != NULL) {
+        if (DecodeLine(line, bytes) != 0) {
+            fputs(line, stdout);
+            continue;
+        }
+
+        uint32_t timeUs = GetWord(bytes);
+        unsigned format = (unsigned)bytes[4] | ((unsigned)bytes[5] << 8);
+        int32_t args[BINLOG_MAX_ARGS];
+        for (int a = 0; a < BINLOG_MAX_ARGS; a++) {
+            args[a] = (int32_t)GetWord(bytes + 8 + 4 * a);
+        }
+
+        if (!haveFirst) {
+            firstUs = timeUs;
+            haveFirst = 1;
+        }
+        // The device clock is kept in 32-bit microseconds; the subtraction handles a wrap
+        printf("[%11.6f] ", (double)(uint32_t)(timeUs - firstUs) / 1e6);
+        if (format < sizeof(formats) / sizeof(*formats)) {
+            printf(formats[format], args[0], args[1], args[2], args[3], args[4], args[5]);
+        } else {
+            printf("Unknown binary log format %u\n", format);
+            unknown++;
+        }
+        records++;
+    }
+
+    if (log != stdin) {
+        fclose(log);
+    }
+    fprintf(stderr, "%u records decoded", records);
+    if (unknown > 0) {
+        fprintf(stderr, ", %u with formats this build does not know", unknown);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_SUCCESS;
+}
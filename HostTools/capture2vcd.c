@@ -0,0 +1,221 @@
+/// Converts a GPIO capture dumped by the test application (GPIO_CAPTURE in platform.h) into a
+/// Value Change Dump that waveform viewers such as GTKWave can open.
+///
+///     capture2vcd [log-file [vcd-file]]
+///
+/// The log is the application's debug output; only the "CAPTURE: " hex lines are used and
+/// everything else is skipped. If the log holds several captures the last complete one is
+/// converted. The log is read from stdin and the VCD written to stdout when the files are omitted.
+/// Each captured GPIO becomes a one-bit wire named after its GPIO number, on a 1 us timescale.
+///
+/// Build from the repository root:
+///     gcc -O2 -IHostTools -IAvnetDevBoardTestApp -o capture2vcd HostTools/capture2vcd.c
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Dump layout, see GpioCapture_Dump
+#include "gpio_capture.h"
+
+#define LINE_MAX_CHARS 1024
+
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+} ByteBuffer;
+
+static uint32_t GetWord(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) |
+           ((uint32_t)bytes[3] << 24);
+}
+
+/// Returns the number of bytes the capture in the buffer needs, or 0 if its header is incomplete.
+static size_t ExpectedLength(const ByteBuffer *buffer)
+{
+    if (buffer->length < GPIO_CAPTURE_HEADER_BYTES) {
+        return 0;
+    }
+    uint32_t gpioCount = GetWord(buffer->bytes + 4);
+    uint32_t runCount = GetWord(buffer->bytes + 8);
+    return GPIO_CAPTURE_HEADER_BYTES + gpioCount + (size_t)runCount * GPIO_CAPTURE_RUN_BYTES;
+}
+
+static int HexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// Decodes the hex after "CAPTURE: " into bytes. Returns the byte count, or -1 if the line is not
+/// a capture line.
+static int DecodeLine(const char *line, uint8_t *bytes, size_t maxBytes)
+{
+    const char *hex = strstr(line, "CAPTURE: ");
+    if (hex == NULL) {
+        return -1;
+    }
+    hex += strlen("CAPTURE: ");
+
+    size_t count = 0;
+    while (count < maxBytes) {
+        int high = HexDigit(hex[2 * count]);
+        int low = (high < 0) ? -1 : HexDigit(hex[2 * count + 1]);
+        if (low < 0) {
+            break;
+        }
+        bytes[count++] = (uint8_t)(high << 4 | low);
+    }
+    return (int)count;
+}
+
+static void Append(ByteBuffer *buffer, const uint8_t *bytes, size_t length)
+{
+    if (buffer->length + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        while (capacity < buffer->length + length) {
+            capacity *= 2;
+        }
+        buffer->bytes = realloc(buffer->bytes, capacity);
+        if (buffer->bytes == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->bytes + buffer->length, bytes, length);
+    buffer->length += length;
+}
+
+/// Reads the log and leaves the last complete capture in done. Returns the number of captures seen.
+static int ReadCaptures(FILE *log, ByteBuffer *done)
+{
+    ByteBuffer current = {0};
+    char line[LINE_MAX_CHARS];
+    uint8_t bytes[LINE_MAX_CHARS / 2];
+    int captures = 0;
+    int collecting = 0;
+
+    while (fgets(line, sizeof(line), log) != NULL) {
+        int count = DecodeLine(line, bytes, sizeof(bytes));
+        if (count <= 0) {
+            continue;
+        }
+
+        // A header line starts a new capture unless the current one is still short of its runs
+        if (!collecting && count >= 4 && GetWord(bytes) == GPIO_CAPTURE_MAGIC) {
+            current.length = 0;
+            collecting = 1;
+        }
+        if (!collecting) {
+            continue;
+        }
+
+        Append(&current, bytes, (size_t)count);
+        size_t expected = ExpectedLength(&current);
+        if (expected != 0 && current.length >= expected) {
+            if (GetWord(current.bytes + 4) <= GPIO_CAPTURE_MAX_GPIOS) {
+                done->length = 0;
+                Append(done, current.bytes, expected);
+                captures++;
+            }
+            collecting = 0;
+        }
+    }
+
+    if (collecting) {
+        fprintf(stderr, "Ignoring a truncated capture at the end of the log\n");
+    }
+    free(current.bytes);
+    return captures;
+}
+
+static void WriteVcd(FILE *vcd, const ByteBuffer *capture)
+{
+    uint32_t gpioCount = GetWord(capture->bytes + 4);
+    uint32_t runCount = GetWord(capture->bytes + 8);
+    uint32_t samples = GetWord(capture->bytes + 12);
+    uint32_t durationUs = GetWord(capture->bytes + 16);
+    const uint8_t *gpios = capture->bytes + GPIO_CAPTURE_HEADER_BYTES;
+    const uint8_t *runs = gpios + gpioCount;
+
+    fprintf(vcd, "$comment MT3620 GPIO capture: %u samples in %u runs over %u us $end\n", samples,
+            runCount, durationUs);
+    fprintf(vcd, "$timescale 1us $end\n");
+    fprintf(vcd, "$scope module mt3620 $end\n");
+    for (uint32_t i = 0; i < gpioCount; i++) {
+        fprintf(vcd, "$var wire 1 %c GPIO%u $end\n", '!' + i, gpios[i]);
+    }
+    fprintf(vcd, "$upscope $end\n$enddefinitions $end\n");
+
+    uint32_t previous = 0;
+    for (uint32_t r = 0; r < runCount; r++) {
+        uint32_t startUs = GetWord(runs + r * GPIO_CAPTURE_RUN_BYTES);
+        uint32_t state = GetWord(runs + r * GPIO_CAPTURE_RUN_BYTES + 8);
+
+        // The first run sets every wire, later runs only the wires that changed
+        uint32_t changed = (r == 0) ? 0xffffffffu : state ^ previous;
+        if (changed == 0) {
+            continue;
+        }
+        fprintf(vcd, "#%u\n", startUs);
+        if (r == 0) {
+            fprintf(vcd, "$dumpvars\n");
+        }
+        for (uint32_t i = 0; i < gpioCount; i++) {
+            if (changed & (1u << i)) {
+                fprintf(vcd, "%u%c\n", (state >> i) & 1u, '!' + i);
+            }
+        }
+        if (r == 0) {
+            fprintf(vcd, "$end\n");
+        }
+        previous = state;
+    }
+    fprintf(vcd, "#%u\n", durationUs);
+}
+
+int main(int argc, char *argv[])
+{
+    FILE *log = stdin;
+    FILE *vcd = stdout;
+
+    if (argc >= 2 && (log = fopen(argv[1], "r")) == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    ByteBuffer capture = {0};
+    int captures = ReadCaptures(log, &capture);
+    if (captures == 0) {
+        fprintf(stderr, "No complete capture found\n");
+        return EXIT_FAILURE;
+    }
+
+    if (argc >= 3 && (vcd = fopen(argv[2], "w")) == NULL) {
+        fprintf(stderr, "Cannot create %s: %s\n", argv[2], strerror(errno));
+        return EXIT_FAILURE;
+    }
+    WriteVcd(vcd, &capture);
+    if (captures > 1) {
+        fprintf(stderr, "%d captures in the log, converted the last\n", captures);
+    }
+
+    if (vcd != stdout) {
+        fclose(vcd);
+    }
+    free(capture.bytes);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/// Host-side microbenchmark for the epoll dispatcher in epoll_timerfd_utilities.c.
+///
+/// N periodic timerfds are armed on a common absolute phase so they expire together, which is the
+/// worst case for a dispatcher that drains one event per epoll_wait. Each configuration is run
+/// once with maxEvents = 1 (the previous behaviour) and once with EPOLL_MAX_EVENTS_PER_WAIT, and
+/// the dispatch throughput, epoll_wait calls per event and expiry-to-handler latency are printed.
+///
+/// Build and run from the repository root:
+///     gcc -O2 -IHostTools -IAvnetDevBoardTestApp -o epoll_dispatch_bench
+///         HostTools/epoll_dispatch_bench.c AvnetDevBoardTestApp/epoll_timerfd_utilities.c
+///     ./epoll_dispatch_bench [seconds-per-run]
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "epoll_timerfd_utilities.h"
+
+#define MAX_TIMERS 256
+#define TIMER_PERIOD_NS 1000000LL
+#define LATENCY_BUCKETS 64 // 50us buckets, last bucket collects everything above
+#define LATENCY_BUCKET_NS 50000LL
+
+static const int timerCounts[] = {1, 16, 64, 256};
+
+static event_data_t timerEventData[MAX_TIMERS];
+static int timerFds[MAX_TIMERS];
+static uint64_t timerExpirations[MAX_TIMERS];
+static long long phaseStartNs;
+static uint64_t expirations;
+static uint64_t latencySumNs;
+static uint64_t latencyMaxNs;
+static uint64_t latencyHistogram[LATENCY_BUCKETS];
+
+static long long NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static void TimerHandler(event_data_t *eventData)
+{
+    uint64_t count = 0;
+    if (read(eventData->fd, &count, sizeof(count)) != sizeof(count)) {
+        // Already consumed, nothing to account for.
+        return;
+    }
+
+    // Latency is measured from the most recent expiry the read reported. The timer's first expiry
+    // is at phaseStartNs and the nth one period later, so a handler that runs more than a period
+    // late shows its full lateness rather than wrapping around the period.
+    uint64_t *timerCount = &timerExpirations[eventData - timerEventData];
+    *timerCount += count;
+    long long deadlineNs = phaseStartNs + (long long)(*timerCount - 1) * TIMER_PERIOD_NS;
+    long long lateNs = NowNs() - deadlineNs;
+    uint64_t latency = lateNs > 0 ? (uint64_t)lateNs : 0;
+    expirations += count;
+    latencySumNs += latency;
+    if (latency > latencyMaxNs) {
+        latencyMaxNs = latency;
+    }
+    size_t bucket = (size_t)(latency / LATENCY_BUCKET_NS);
+    latencyHistogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+}
+
+static uint64_t LatencyPercentileNs(double percentile)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        total += latencyHistogram[i];
+    }
+    uint64_t threshold = (uint64_t)((double)total * percentile);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += latencyHistogram[i];
+        if (seen > threshold) {
+            return (i + 1) * LATENCY_BUCKET_NS;
+        }
+    }
+    return LATENCY_BUCKETS * LATENCY_BUCKET_NS;
+}
+
+static bool RunConfiguration(int timerCount, int maxEvents, double seconds)
+{
+    int epollFd = CreateEpollFd();
+    if (epollFd < 0) {
+        return false;
+    }
+
+    static const struct timespec period = {0, TIMER_PERIOD_NS};
+    for (int i = 0; i < timerCount; i++) {
+        timerEventData[i].eventHandler = &TimerHandler;
+        timerFds[i] = CreateTimerFdAndAddToEpoll(epollFd, &period, &timerEventData[i], EPOLLIN);
+        if (timerFds[i] < 0) {
+            return false;
+        }
+    }
+
+    // Re-arm every timer on one absolute phase so they all become ready together.
+    phaseStartNs = NowNs() + 10 * TIMER_PERIOD_NS;
+    struct itimerspec phase = {.it_interval = period,
+                               .it_value = {.tv_sec = phaseStartNs / 1000000000LL,
+                                            .tv_nsec = phaseStartNs % 1000000000LL}};
+    for (int i = 0; i < timerCount; i++) {
+        if (timerfd_settime(timerFds[i], TFD_TIMER_ABSTIME, &phase, NULL) != 0) {
+            fprintf(stderr, "timerfd_settime: %s\n", strerror(errno));
+            return false;
+        }
+    }
+
+    memset(timerExpirations, 0, sizeof(timerExpirations));
+    expirations = 0;
+    latencySumNs = 0;
+    latencyMaxNs = 0;
+    memset(latencyHistogram, 0, sizeof(latencyHistogram));
+    ResetEpollDispatchStats();
+
+    long long endNs = phaseStartNs + (long long)(seconds * 1e9);
+    while (NowNs() < endNs) {
+        if (WaitForEventsAndCallHandlers(epollFd, maxEvents) != 0) {
+            return false;
+        }
+    }
+
+    epoll_dispatch_stats_t stats;
+    GetEpollDispatchStats(&stats);
+    double elapsed = (double)(NowNs() - phaseStartNs) / 1e9;
+    double expected = (double)timerCount * elapsed * 1e9 / (double)TIMER_PERIOD_NS;
+
+    printf("%6d %9d %12.0f %10.1f%% %10.3f %9.1f %9llu %9llu %9.1f\n", timerCount, maxEvents,
+           (double)stats.eventsDispatched / elapsed, 100.0 * (double)expirations / expected,
+           stats.eventsDispatched ? (double)stats.waits / stats.eventsDispatched : 0.0,
+           stats.eventsDispatched ? (double)latencySumNs / (double)stats.eventsDispatched / 1000.0 : 0.0,
+           (unsigned long long)(LatencyPercentileNs(0.99) / 1000),
+           (unsigned long long)(latencyMaxNs / 1000),
+           stats.waits ? (double)stats.eventsDispatched / stats.waits : 0.0);
+
+    for (int i = 0; i < timerCount; i++) {
+        CloseFdAndPrintError(timerFds[i], "BenchTimer");
+    }
+    CloseFdAndPrintError(epollFd, "BenchEpoll");
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 1.0;
+    if (seconds <= 0) {
+        seconds = 1.0;
+    }
+
+    printf("%6s %9s %12s %11s %10s %9s %9s %9s %9s\n", "timers", "maxEvents", "dispatch/s",
+           "expiry-seen", "waits/evt", "mean-us", "p99-us", "max-us", "evt/wait");
+    for (size_t i = 0; i < sizeof(timerCounts) / sizeof(*timerCounts); i++) {
+        if (!RunConfiguration(timerCounts[i], 1, seconds) ||
+            !RunConfiguration(timerCounts[i], EPOLL_MAX_EVENTS_PER_WAIT, seconds)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+/// Shared-memory layout of the simulated MT3620 pins used by applibs_sim.c and mt3620sim_ctl.c.
+///
+/// The application under test owns the segment: it is created and reset by the first applibs
+/// call and its wiring is loaded from the simulator configuration. mt3620sim_ctl attaches to the
+/// same segment to force inputs (for example to press a button) or to dump the pin state.
+#pragma once
+
+#include <stdint.h>
+
+#define MT3620SIM_SHM_DEFAULT_NAME "/mt3620sim"
+#define MT3620SIM_MAGIC 0x4d543632u
+#define MT3620SIM_GPIO_COUNT 96
+#define MT3620SIM_NO_WIRE -1
+
+/// <summary>
+/// State of one simulated pin.
+/// </summary>
+typedef struct {
+    /// <summary>
+    /// Non-zero while the application holds the pin open as an output
+    /// </summary>
+    uint8_t driven;
+    /// <summary>
+    /// Level driven by the application
+    /// </summary>
+    uint8_t outputLevel;
+    /// <summary>
+    /// Non-zero while mt3620sim_ctl forces the pin, overriding everything else
+    /// </summary>
+    uint8_t forced;
+    /// <summary>
+    /// Level forced by mt3620sim_ctl
+    /// </summary>
+    uint8_t forcedLevel;
+    /// <summary>
+    /// Pin this one is jumpered to, or MT3620SIM_NO_WIRE
+    /// </summary>
+    int16_t wire;
+} mt3620sim_pin_t;
+
+/// <summary>
+/// The shared-memory segment.
+/// </summary>
+typedef struct {
+    uint32_t magic;
+    uint32_t ownerPid;
+    mt3620sim_pin_t pins[MT3620SIM_GPIO_COUNT];
+} mt3620sim_shared_t;
+
+/// <summary>
+///     Resolves the level an input would read on a pin: a forced level wins, then the pin's own
+///     output, then whatever drives the pin it is wired to, and finally the pull-up.
+/// </summary>
+static inline uint8_t Mt3620Sim_ResolveLevel(const mt3620sim_shared_t *shared, int pin)
+{
+    const mt3620sim_pin_t *self = &shared->pins[pin];
+    if (self->forced) {
+        return self->forcedLevel;
+    }
+    if (self->driven) {
+        return self->outputLevel;
+    }
+    if (self->wire != MT3620SIM_NO_WIRE) {
+        const mt3620sim_pin_t *peer = &shared->pins[self->wire];
+        if (peer->forced) {
+            return peer->forcedLevel;
+        }
+        if (peer->driven) {
+            return peer->outputLevel;
+        }
+    }
+    return 1;
+}
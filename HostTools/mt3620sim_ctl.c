@@ -0,0 +1,97 @@
+/// Drives the simulated MT3620 pins of a running host build of the test application.
+///
+///     mt3620sim_ctl press <gpio> [ms]     force the pin low for ms (default 100), then release
+///     mt3620sim_ctl force <gpio> <0|1>    force the pin to a level until released
+///     mt3620sim_ctl release <gpio>        stop forcing the pin
+///     mt3620sim_ctl dump                  print every pin that is driven, forced or wired
+///
+/// Build from the repository root:
+///     gcc -O2 -IHostTools -o mt3620sim_ctl HostTools/mt3620sim_ctl.c -lrt
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mt3620sim.h"
+
+static mt3620sim_shared_t *AttachShared(void)
+{
+    const char *shmName = getenv("MT3620SIM_SHM");
+    if (shmName == NULL) {
+        shmName = MT3620SIM_SHM_DEFAULT_NAME;
+    }
+
+    int shmFd = shm_open(shmName, O_RDWR, 0);
+    if (shmFd < 0) {
+        fprintf(stderr, "Cannot open %s: %s (is the application running?)\n", shmName,
+                strerror(errno));
+        return NULL;
+    }
+    mt3620sim_shared_t *shared =
+        mmap(NULL, sizeof(mt3620sim_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    close(shmFd);
+    if (shared == MAP_FAILED || shared->magic != MT3620SIM_MAGIC) {
+        fprintf(stderr, "%s is not an initialized simulator segment\n", shmName);
+        return NULL;
+    }
+    return shared;
+}
+
+static int ParsePin(const char *text)
+{
+    int pin = atoi(text);
+    if (pin < 0 || pin >= MT3620SIM_GPIO_COUNT) {
+        fprintf(stderr, "GPIO %s out of range\n", text);
+        exit(EXIT_FAILURE);
+    }
+    return pin;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s press|force|release|dump ...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    mt3620sim_shared_t *shared = AttachShared();
+    if (shared == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    if (strcmp(argv[1], "press") == 0 && argc >= 3) {
+        int pin = ParsePin(argv[2]);
+        long ms = (argc >= 4) ? atol(argv[3]) : 100;
+        shared->pins[pin].forcedLevel = 0;
+        shared->pins[pin].forced = 1;
+        struct timespec hold = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000};
+        nanosleep(&hold, NULL);
+        shared->pins[pin].forced = 0;
+    } else if (strcmp(argv[1], "force") == 0 && argc >= 4) {
+        int pin = ParsePin(argv[2]);
+        shared->pins[pin].forcedLevel = atoi(argv[3]) ? 1 : 0;
+        shared->pins[pin].forced = 1;
+    } else if (strcmp(argv[1], "release") == 0 && argc >= 3) {
+        shared->pins[ParsePin(argv[2])].forced = 0;
+    } else if (strcmp(argv[1], "dump") == 0) {
+        printf("owner pid %u\n", shared->ownerPid);
+        printf("%4s %6s %6s %6s %5s\n", "gpio", "driven", "forced", "level", "wire");
+        for (int i = 0; i < MT3620SIM_GPIO_COUNT; i++) {
+            const mt3620sim_pin_t *pin = &shared->pins[i];
+            if (pin->driven || pin->forced || pin->wire != MT3620SIM_NO_WIRE) {
+                printf("%4d %6s %6s %6d %5d\n", i, pin->driven ? "yes" : "-",
+                       pin->forced ? "yes" : "-", Mt3620Sim_ResolveLevel(shared, i), pin->wire);
+            }
+        }
+    } else {
+        fprintf(stderr, "unrecognized command\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
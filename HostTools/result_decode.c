@@ -0,0 +1,337 @@
+/// Decodes the binary result stream that the test application sends on RESULT_STREAM_UART when
+/// RESULT_STREAM is defined in platform.h, and prints each run as CSV or JSON.
+///
+///     result_decode [--json] [stream-file-or-tty]
+///
+/// The stream is read from stdin when no file is given. A tty is switched to raw mode at 921600
+/// baud, RESULT_STREAM_BAUD in platform.h, and read until interrupted. A run is printed when its
+/// run end record arrives: in CSV one row per test and a final row named RUN with the overall
+/// result, in JSON one object per line. The application sends the test names, categories and
+/// expected durations with its first run and every 16th run after that; until the decoder has seen
+/// them, tests are named test0, test1 and so on. Frames with a bad CRC are counted and skipped, and a run
+/// that lost a frame is not printed. The record layout comes from
+/// AvnetDevBoardTestApp/result_stream_protocol.h.
+///
+/// Build from the repository root:
+///     gcc -O2 -IAvnetDevBoardTestApp -o result_decode HostTools/result_decode.c
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "result_stream_protocol.h"
+
+#define MAX_TESTS 256
+#define NAME_MAX_CHARS RESULT_STREAM_MAX_RECORD
+
+// TestCategory and TestRegistry_Verdict in AvnetDevBoardTestApp/test_registry.h
+static const char *const categories[] = {"other", "gpio", "uart", "wifi", "led"};
+static const char *const verdicts[] = {"not run", "passed", "failed"};
+
+// What the test information record says about a test; kept across runs
+typedef struct {
+    char name[NAME_MAX_CHARS + 1];
+    unsigned category;
+    uint32_t expectedMs;
+} TestInfo;
+
+typedef struct {
+    bool haveResult;
+    unsigned verdict;
+    int failureIndex;
+    int failurePins[2];
+    uint32_t startMs;
+    uint32_t durationMs;
+} TestResult;
+
+static bool json = false;
+
+// The run being collected
+static bool inRun = false;
+static bool runDamaged = false;
+static unsigned runNumber = 0;
+static unsigned testCount = 0;
+static TestInfo infos[MAX_TESTS];
+static TestResult results[MAX_TESTS];
+
+static unsigned frames = 0;
+static unsigned badFrames = 0;
+static unsigned runsPrinted = 0;
+static unsigned runsIncomplete = 0;
+
+static uint16_t Crc16(const uint8_t *data, size_t length)
+{
+    uint16_t crc = 0xffff;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t GetU16(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8);
+}
+
+static uint32_t GetU32(const uint8_t *bytes)
+{
+    return GetU16(bytes) | (GetU16(bytes + 2) << 16);
+}
+
+/// Decodes a COBS frame without its delimiter. Returns the decoded length, or -1 if the frame is
+/// malformed.
+static int CobsDecode(const uint8_t *frame, size_t length, uint8_t *out)
+{
+    size_t outLength = 0;
+    size_t i = 0;
+    while (i < length) {
+        uint8_t code = frame[i++];
+        if (code == 0 || i + code - 1 > length) {
+            return -1;
+        }
+        for (uint8_t k = 1; k < code; k++) {
+            out[outLength++] = frame[i++];
+        }
+        if (code != 0xff && i < length) {
+            out[outLength++] = 0;
+        }
+    }
+    return (int)outLength;
+}
+
+static const char *CategoryName(unsigned category)
+{
+    return category < sizeof(categories) / sizeof(*categories) ? categories[category] : "unknown";
+}
+
+static const char *VerdictName(unsigned verdict)
+{
+    return verdict < sizeof(verdicts) / sizeof(*verdicts) ? verdicts[verdict] : "unknown";
+}
+
+/// Prints a test name as a JSON string; test names are plain ASCII, anything else is escaped.
+static void PrintJsonString(const char *text)
+{
+    putchar('"');
+    for (const char *c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            printf("\\%c", *c);
+        } else if ((unsigned char)*c < 0x20 || (unsigned char)*c > 0x7e) {
+            printf("\\u%04x", (unsigned char)*c);
+        } else {
+            putchar(*c);
+        }
+    }
+    putchar('"');
+}
+
+static void PrintRun(bool allPassed, uint32_t durationMs)
+{
+    if (json) {
+        printf("{\"run\":%u,\"passed\":%s,\"duration_ms\":%u,\"tests\":[", runNumber,
+               allPassed ? "true" : "false", durationMs);
+        for (unsigned t = 0; t < testCount; t++) {
+            const TestResult *r = &results[t];
+            printf("%s{\"test\":%u,\"name\":", t > 0 ? "," : "", t);
+            PrintJsonString(infos[t].name);
+            printf(",\"category\":\"%s\",\"verdict\":\"%s\",\"failure_index\":%d,"
+                   "\"failure_gpios\":[",
+                   CategoryName(infos[t].category), VerdictName(r->verdict), r->failureIndex);
+            bool first = true;
+            for (int pin = 0; pin < 2; pin++) {
+                if (r->failurePins[pin] >= 0) {
+                    printf("%s%d", first ? "" : ",", r->failurePins[pin]);
+                    first = false;
+                }
+            }
+            printf("],\"start_ms\":%u,\"duration_ms\":%u,\"expected_ms\":%u}", r->startMs,
+                   r->durationMs, infos[t].expectedMs);
+        }
+        printf("]}\n");
+    } else {
+        for (unsigned t = 0; t < testCount; t++) {
+            const TestResult *r = &results[t];
+            printf("%u,%u,%s,%s,%s,", runNumber, t, infos[t].name, CategoryName(infos[t].category),
+                   VerdictName(r->verdict));
+            if (r->failureIndex >= 0) {
+                printf("%d", r->failureIndex);
+            }
+            for (int pin = 0; pin < 2; pin++) {
+                putchar(',');
+                if (r->failurePins[pin] >= 0) {
+                    printf("%d", r->failurePins[pin]);
+                }
+            }
+            printf(",%u,%u,%u\n", r->startMs, r->durationMs, infos[t].expectedMs);
+        }
+        printf("%u,,RUN,,%s,,,,0,%u,\n", runNumber, allPassed ? "passed" : "failed", durationMs);
+    }
+    fflush(stdout);
+    runsPrinted++;
+}
+
+static void HandleRecord(const uint8_t *record, size_t length)
+{
+    switch (record[0]) {
+    case RESULT_STREAM_RUN_START:
+        if (length < 4) {
+            break;
+        }
+        if (inRun) {
+            runsIncomplete++;
+        }
+        inRun = true;
+        runDamaged = false;
+        runNumber = GetU16(record + 1);
+        testCount = record[3];
+        for (unsigned t = 0; t < MAX_TESTS; t++) {
+            results[t].haveResult = false;
+        }
+        return;
+
+    case RESULT_STREAM_TEST_INFO:
+        if (length < 7 || length - 7 > NAME_MAX_CHARS) {
+            break;
+        }
+        TestInfo *info = &infos[record[1]];
+        info->category = record[2];
+        info->expectedMs = GetU32(record + 3);
+        memcpy(info->name, record + 7, length - 7);
+        info->name[length - 7] = '\0';
+        return;
+
+    case RESULT_STREAM_TEST_RESULT:
+        if (length < 15 || !inRun || record[1] >= testCount) {
+            break;
+        }
+        TestResult *r = &results[record[1]];
+        r->haveResult = true;
+        r->verdict = record[2];
+        r->failureIndex = (int16_t)GetU16(record + 3);
+        for (int pin = 0; pin < 2; pin++) {
+            r->failurePins[pin] = (record[5 + pin] == RESULT_STREAM_NO_PIN) ? -1 : record[5 + pin];
+        }
+        r->startMs = GetU32(record + 7);
+        r->durationMs = GetU32(record + 11);
+        return;
+
+    case RESULT_STREAM_RUN_END:
+        if (length < 8 || !inRun) {
+            break;
+        }
+        inRun = false;
+        for (unsigned t = 0; t < testCount; t++) {
+            runDamaged = runDamaged || !results[t].haveResult;
+        }
+        if (runDamaged || GetU16(record + 1) != runNumber) {
+            runsIncomplete++;
+            return;
+        }
+        PrintRun(record[3] != 0, GetU32(record + 4));
+        return;
+
+    default:
+        // A record type added after this decoder was built
+        return;
+    }
+
+    // A record that is too short or arrived outside a run
+    runDamaged = true;
+}
+
+static void HandleFrame(const uint8_t *frame, size_t length)
+{
+    uint8_t record[RESULT_STREAM_MAX_FRAME];
+
+    if (length == 0) {
+        return;
+    }
+    frames++;
+
+    int recordLength = (length <= RESULT_STREAM_MAX_FRAME) ? CobsDecode(frame, length, record) : -1;
+    if (recordLength < 3 ||
+        Crc16(record, (size_t)recordLength - 2) != GetU16(record + recordLength - 2)) {
+        badFrames++;
+        runDamaged = true;
+        return;
+    }
+    HandleRecord(record, (size_t)recordLength - 2);
+}
+
+int main(int argc, char *argv[])
+{
+    int fd = STDIN_FILENO;
+    const char *path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path != NULL && (fd = open(path, O_RDONLY | O_NOCTTY)) < 0) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (isatty(fd)) {
+        struct termios tio;
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        cfsetspeed(&tio, B921600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    // Until a test information record arrives a test is only known by its index
+    for (unsigned t = 0; t < MAX_TESTS; t++) {
+        snprintf(infos[t].name, sizeof(infos[t].name), "test%u", t);
+        infos[t].category = UINT8_MAX;
+    }
+
+    if (!json) {
+        printf("run,test,name,category,verdict,failure_index,failure_gpio_a,failure_gpio_b,start_ms,"
+               "duration_ms,expected_ms\n");
+    }
+
+    // Bytes of the frame being received; an overlong frame is kept short and fails its CRC
+    uint8_t frame[RESULT_STREAM_MAX_FRAME + 1];
+    size_t frameLength = 0;
+    uint8_t buffer[4096];
+    ssize_t count;
+    unsigned long bytes = 0;
+
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+        bytes += (unsigned long)count;
+        for (ssize_t i = 0; i < count; i++) {
+            if (buffer[i] == 0) {
+                HandleFrame(frame, frameLength);
+                frameLength = 0;
+            } else if (frameLength < sizeof(frame)) {
+                frame[frameLength++] = buffer[i];
+            }
+        }
+    }
+
+    if (fd != STDIN_FILENO) {
+        close(fd);
+    }
+    fprintf(stderr, "%lu bytes, %u frames, %u runs", bytes, frames, runsPrinted);
+    if (badFrames > 0) {
+        fprintf(stderr, ", %u frames failed their check", badFrames);
+    }
+    if (runsIncomplete > 0) {
+        fprintf(stderr, ", %u incomplete runs skipped", runsIncomplete);
+    }
+    fprintf(stderr, "\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+/// Host-side benchmark of the timer wheel in epoll_timerfd_utilities.c against one timerfd per timer.
+///
+/// N periodic timers with periods of 10-19 ms and staggered phases run for a fixed time, first as N
+/// kernel timerfds on the epoll instance (the CreateTimerFdAndAddToEpoll approach) and then as N
+/// wheel timers sharing one timerfd. For each it prints the event loop wakeups and timer syscalls
+/// per second, the CPU time used, and how late the handlers ran against the ideal schedule (p50,
+/// p99, max). Timers that fire early are counted as errors.
+///
+/// Build and run from the repository root:
+///     gcc -O2 -IHostTools -IAvnetDevBoardTestApp -o timer_wheel_bench HostTools/timer_wheel_bench.c
+///         AvnetDevBoardTestApp/epoll_timerfd_utilities.c AvnetDevBoardTestApp/latency_stats.c
+///     ./timer_wheel_bench [seconds-per-run]
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "epoll_timerfd_utilities.h"
+#include "latency_stats.h"
+
+#define MAX_TIMERS 1000
+#define BASE_PERIOD_NS 10000000LL
+#define PERIOD_STEPS 10
+#define PHASE_STEP_NS 97000LL
+
+static const int timerCounts[] = {10, 100, 1000};
+
+typedef struct {
+    event_data_t eventData;
+    wheel_timer_t wheelTimer;
+    int fd;
+    long long periodNs;
+    long long nextDueNs;
+} BenchTimer;
+
+static BenchTimer timers[MAX_TIMERS];
+static LatencyStats lateness;
+static uint64_t earlyFirings;
+static uint64_t timerSyscalls;
+
+static long long NowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static struct timespec NsToTimespec(long long ns)
+{
+    struct timespec ts = {.tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL};
+    return ts;
+}
+
+/// Records how late an expiry was handled and moves the timer's ideal schedule on.
+static void RecordExpiry(BenchTimer *timer, uint64_t count)
+{
+    long long late = NowNs() - timer->nextDueNs;
+    if (late < 0) {
+        earlyFirings++;
+        late = 0;
+    }
+    LatencyStats_Add(&lateness, (uint64_t)late);
+    timer->nextDueNs += (long long)count * timer->periodNs;
+}
+
+static void TimerFdHandler(event_data_t *eventData)
+{
+    BenchTimer *timer = (BenchTimer *)eventData;
+    uint64_t count = 0;
+    timerSyscalls++;
+    if (read(timer->fd, &count, sizeof(count)) != sizeof(count)) {
+        return;
+    }
+    RecordExpiry(timer, count);
+}
+
+static void WheelHandler(wheel_timer_t *wheelTimer)
+{
+    BenchTimer *timer =
+        (BenchTimer *)((char *)wheelTimer - __builtin_offsetof(BenchTimer, wheelTimer));
+    RecordExpiry(timer, 1);
+}
+
+static double CpuSeconds(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec / 1e6 +
+           (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec / 1e6;
+}
+
+static bool RunConfiguration(int timerCount, bool useWheel, double seconds)
+{
+    int epollFd = CreateEpollFd();
+    if (epollFd < 0) {
+        return false;
+    }
+    if (useWheel && CreateTimerWheel(epollFd) != 0) {
+        return false;
+    }
+
+    LatencyStats_Reset(&lateness);
+    earlyFirings = 0;
+    timerSyscalls = 0;
+
+    long long startNs = NowNs() + 20000000LL;
+    for (int i = 0; i < timerCount; i++) {
+        BenchTimer *timer = &timers[i];
+        memset(timer, 0, sizeof(*timer));
+        timer->periodNs = BASE_PERIOD_NS + (i % PERIOD_STEPS) * 1000000LL;
+        timer->nextDueNs = startNs + (i * PHASE_STEP_NS) % timer->periodNs;
+        struct timespec period = NsToTimespec(timer->periodNs);
+
+        if (useWheel) {
+            timer->wheelTimer.handler = &WheelHandler;
+            struct timespec delay = NsToTimespec(timer->nextDueNs - NowNs());
+            if (StartWheelTimer(&timer->wheelTimer, &delay, &period) != 0) {
+                return false;
+            }
+        } else {
+            static const struct timespec disarmed = {0, 0};
+            timer->eventData.eventHandler = &TimerFdHandler;
+            timer->fd = CreateTimerFdAndAddToEpoll(epollFd, &disarmed, &timer->eventData, EPOLLIN);
+            if (timer->fd < 0) {
+                return false;
+            }
+            struct itimerspec schedule = {.it_value = NsToTimespec(timer->nextDueNs),
+                                          .it_interval = period};
+            if (timerfd_settime(timer->fd, TFD_TIMER_ABSTIME, &schedule, NULL) != 0) {
+                fprintf(stderr, "timerfd_settime: %s\n", strerror(errno));
+                return false;
+            }
+        }
+    }
+
+    ResetEpollDispatchStats();
+    ResetTimerWheelStats();
+    double cpuStart = CpuSeconds();
+    long long endNs = startNs + (long long)(seconds * 1e9);
+    while (NowNs() < endNs) {
+        if (WaitForEventsAndCallHandlers(epollFd, EPOLL_MAX_EVENTS_PER_WAIT) != 0) {
+            return false;
+        }
+    }
+    double cpu = CpuSeconds() - cpuStart;
+    double elapsed = (double)(NowNs() - startNs) / 1e9;
+
+    epoll_dispatch_stats_t dispatch;
+    GetEpollDispatchStats(&dispatch);
+    timer_wheel_stats_t wheel;
+    GetTimerWheelStats(&wheel);
+
+    // Each wakeup is one epoll_wait. The wheel adds one read per wakeup plus its rearms; the
+    // timerfds add one read per ready timer.
+    uint64_t syscalls = dispatch.waits + (useWheel ? wheel.wakeups + wheel.rearms : timerSyscalls);
+
+    printf("%6d %-8s %4d %11.0f %11.0f %8.1f%% %8.1f %8.1f %8.1f %7llu\n", timerCount,
+           useWheel ? "wheel" : "timerfd", useWheel ? 1 : timerCount,
+           (double)dispatch.waits / elapsed, (double)syscalls / elapsed, 100.0 * cpu / elapsed,
+           (double)LatencyStats_Percentile(&lateness, 50) / 1000.0,
+           (double)LatencyStats_Percentile(&lateness, 99) / 1000.0,
+           (double)lateness.maxNs / 1000.0, (unsigned long long)earlyFirings);
+
+    if (useWheel) {
+        for (int i = 0; i < timerCount; i++) {
+            StopWheelTimer(&timers[i].wheelTimer);
+        }
+        CloseTimerWheel();
+    } else {
+        for (int i = 0; i < timerCount; i++) {
+            CloseFdAndPrintError(timers[i].fd, "BenchTimer");
+        }
+    }
+    CloseFdAndPrintError(epollFd, "BenchEpoll");
+    return earlyFirings == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    if (seconds <= 0) {
+        seconds = 2.0;
+    }
+
+    // One timerfd per timer needs more descriptors than the usual soft limit of 1024
+    struct rlimit files;
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < MAX_TIMERS + 64) {
+        files.rlim_cur = (files.rlim_max < MAX_TIMERS + 64) ? files.rlim_max : MAX_TIMERS + 64;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+
+    printf("%6s %-8s %4s %11s %11s %9s %8s %8s %8s %7s\n", "timers", "mode", "fds", "wakeups/s",
+           "syscalls/s", "cpu", "p50-us", "p99-us", "max-us", "early");
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(timerCounts) / sizeof(*timerCounts); i++) {
+        ok = RunConfiguration(timerCounts[i], false, seconds) && ok;
+        ok = RunConfiguration(timerCounts[i], true, seconds) && ok;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}